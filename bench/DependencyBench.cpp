@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "Dependency.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+
+////////////////////////////////////////
+
+
+// Synthetic graph shaped like a large project: every object file
+// depends on the same handful of generated headers, objects go into
+// libraries, and each library chains on the one before it. Headers
+// are created last so most of their edges run against the initial
+// order and have to be re-ordered. Insertion should stay near linear
+// in the number of edges, as should tearing the graph down again even
+// though every object shares the headers.
+
+namespace
+{
+
+struct NodeDir
+{
+	const std::string &fullpath( void ) const { return myPath; }
+	std::string myPath;
+};
+
+class Node : public Dependency<Node>
+{
+public:
+	Node( std::string n ) : myName( std::move( n ) ) {}
+
+	const std::string &getName( void ) const override { return myName; }
+	const std::shared_ptr<NodeDir> &getDir( void ) const { return myDir; }
+
+private:
+	std::string myName;
+	std::shared_ptr<NodeDir> myDir;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince( Clock::time_point s )
+{
+	return std::chrono::duration<double, std::milli>( Clock::now() - s ).count();
+}
+
+void
+runGraph( size_t nObjs )
+{
+	const size_t nHeaders = 8;
+	const size_t objsPerLib = 100;
+	const size_t nLibs = ( nObjs + objsPerLib - 1 ) / objsPerLib;
+
+	std::vector<std::shared_ptr<Node>> objs, libs, headers;
+	objs.reserve( nObjs );
+	for ( size_t i = 0; i != nObjs; ++i )
+		objs.push_back( std::make_shared<Node>( "obj" + std::to_string( i ) + ".o" ) );
+	for ( size_t i = 0; i != nLibs; ++i )
+		libs.push_back( std::make_shared<Node>( "lib" + std::to_string( i ) + ".a" ) );
+	for ( size_t i = 0; i != nHeaders; ++i )
+		headers.push_back( std::make_shared<Node>( "gen" + std::to_string( i ) + ".h" ) );
+
+	size_t edges = 0;
+	auto start = Clock::now();
+	for ( size_t i = 0; i != nLibs; ++i )
+	{
+		if ( i > 0 )
+		{
+			libs[i]->addDependency( DependencyType::CHAIN, libs[i - 1] );
+			++edges;
+		}
+	}
+	for ( size_t i = 0; i != nObjs; ++i )
+	{
+		libs[i / objsPerLib]->addDependency( DependencyType::EXPLICIT, objs[i] );
+		for ( auto &h: headers )
+			objs[i]->addDependency( DependencyType::IMPLICIT, h );
+		edges += 1 + nHeaders;
+	}
+	double insertMs = msSince( start );
+
+	start = Clock::now();
+	size_t reachable = libs.back()->dependencies( DependencyType::CHAIN ).size();
+	double chainMs = msSince( start );
+
+	start = Clock::now();
+	libs.clear();
+	objs.clear();
+	double teardownMs = msSince( start );
+	headers.clear();
+
+	std::cout << std::setw( 8 ) << nObjs
+			  << std::setw( 10 ) << edges
+			  << std::setw( 12 ) << std::fixed << std::setprecision( 2 ) << insertMs
+			  << std::setw( 10 ) << std::setprecision( 1 ) << ( insertMs * 1e6 / double( edges ) )
+			  << std::setw( 12 ) << std::setprecision( 2 ) << teardownMs
+			  << std::setw( 10 ) << chainMs
+			  << std::setw( 8 ) << reachable
+			  << std::endl;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+int
+main( void )
+{
+	std::cout << "    objs     edges   insert ms   ns/edge teardown ms  chain ms   chain" << std::endl;
+	for ( size_t n = 12500; n <= 100000; n *= 2 )
+		runGraph( n );
+	return 0;
+}
@@ -0,0 +1,185 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "FlagList.h"
+#include "../test/VectorFlags.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+
+////////////////////////////////////////
+
+
+// The flag propagation of CompileSet::fillBuildItem on a large
+// executable: the includes and defines of each library dependency
+// gathered with addIfMissing (libraries share many of them), the
+// library list de-duplicated keeping the last entry, then the
+// gathered flags moved to the end of each object's own flags, and
+// the prefix de-duplication the generators apply. Timed for
+// FlagList and for the vector operations it replaced, checking both
+// give the same lists.
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+typedef VectorFlags::List List;
+
+const size_t theFlagsPerLib = 6;
+const size_t theObjects = 40;
+
+double
+msSince( Clock::time_point s )
+{
+	return std::chrono::duration<double, std::milli>( Clock::now() - s ).count();
+}
+
+struct Result
+{
+	List flags;
+	List libs;
+	List object;
+};
+
+std::vector<List>
+libraryFlags( size_t nLibs )
+{
+	std::vector<List> ret( nLibs );
+	for ( size_t l = 0; l != nLibs; ++l )
+	{
+		for ( size_t j = 0; j != theFlagsPerLib; ++j )
+		{
+			size_t k = ( l * 7 + j * 13 ) % nLibs;
+			if ( j % 3 == 2 )
+				ret[l].push_back( "-DHAVE_FEATURE_" + std::to_string( k ) + "=1" );
+			else
+				ret[l].push_back( "-I/usr/local/include/some/longer/path/lib" + std::to_string( k ) );
+		}
+	}
+	return ret;
+}
+
+List
+libraryNames( size_t nLibs )
+{
+	// each library followed by (a repeat of) one it depends on
+	List ret;
+	for ( size_t l = 0; l != nLibs; ++l )
+	{
+		ret.push_back( "-llib" + std::to_string( l ) );
+		ret.push_back( "-llib" + std::to_string( ( l * 31 ) % nLibs ) );
+	}
+	return ret;
+}
+
+const List theObjectFlags{ "-O2", "-I/usr/local/include/some/longer/path/lib3", "-DNDEBUG" };
+const std::map<std::string, bool> thePrefixes{ { "-I", true }, { "-D", true }, { "-l", false } };
+
+double
+runVector( const std::vector<List> &libFlags, const List &libNames, Result &res )
+{
+	auto start = Clock::now();
+	List flags, libs;
+	for ( const List &l: libFlags )
+	{
+		for ( const std::string &f: l )
+			VectorFlags::addIfMissing( flags, f );
+	}
+	libs = libNames;
+	VectorFlags::removeDuplicatesKeepLast( libs );
+
+	for ( size_t o = 0; o != theObjects; ++o )
+	{
+		List obj = theObjectFlags;
+		for ( const std::string &f: flags )
+			VectorFlags::moveToEnd( obj, f );
+		obj.insert( obj.end(), flags.begin(), flags.end() );
+		VectorFlags::removeDuplicates( obj, thePrefixes );
+		if ( o == 0 )
+			res.object = obj;
+	}
+	double ms = msSince( start );
+	res.flags = std::move( flags );
+	res.libs = std::move( libs );
+	return ms;
+}
+
+double
+runFlagList( const std::vector<List> &libFlags, const List &libNames, Result &res )
+{
+	auto start = Clock::now();
+	FlagList flags, libs;
+	for ( const List &l: libFlags )
+		flags.addIfMissing( l );
+	libs.assign( libNames );
+	libs.removeDuplicatesKeepLast();
+
+	for ( size_t o = 0; o != theObjects; ++o )
+	{
+		FlagList obj;
+		obj.assign( theObjectFlags );
+		obj.moveToEnd( flags );
+		obj.append( flags.values() );
+		obj.removeDuplicates( thePrefixes );
+		if ( o == 0 )
+			res.object = obj.values();
+	}
+	double ms = msSince( start );
+	res.flags = flags.values();
+	res.libs = libs.values();
+	return ms;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+int
+main( void )
+{
+	std::cout << "    libs   flags  vector ms  flaglist ms" << std::endl;
+	for ( size_t n = 50; n <= 3200; n *= 4 )
+	{
+		std::vector<List> libFlags = libraryFlags( n );
+		List libNames = libraryNames( n );
+
+		Result v, f;
+		double vMs = runVector( libFlags, libNames, v );
+		double fMs = runFlagList( libFlags, libNames, f );
+		if ( v.flags != f.flags || v.libs != f.libs || v.object != f.object )
+		{
+			std::cerr << "ERROR: FlagList and vector results differ for " << n << " libraries" << std::endl;
+			return 1;
+		}
+
+		std::cout << std::setw( 8 ) << n
+				  << std::setw( 8 ) << v.flags.size()
+				  << std::setw( 11 ) << std::fixed << std::setprecision( 2 ) << vMs
+				  << std::setw( 13 ) << fMs
+				  << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+
+#include "PackageSet.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+////////////////////////////////////////
+
+
+// The cold package lookup: a project with many dependencies resolves
+// each of them through PackageSet::find, which scans the search path
+// once and then parses the .pc files it is asked for (and their
+// Requires) serially under the set's lock. Writes a synthetic tree of
+// 500 packages split over a few search directories, each package
+// requiring two earlier ones in the same directory, and compares
+// resolving all of them through one set against one set per
+// directory resolved in parallel on the thread pool. The parallel run
+// is the most a parallel parse of the .pc files could win.
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince( Clock::time_point s )
+{
+	return std::chrono::duration<double, std::milli>( Clock::now() - s ).count();
+}
+
+const size_t thePackages = 500;
+const size_t theDirs = 4;
+const size_t theRounds = 5;
+
+std::string
+pkgName( size_t i )
+{
+	return "bench" + std::to_string( i );
+}
+
+void
+writeTree( const std::string &root, std::vector<std::string> &dirs )
+{
+	for ( size_t d = 0; d != theDirs; ++d )
+	{
+		std::string dir = root + "/pc" + std::to_string( d );
+		if ( ::mkdir( dir.c_str(), 0755 ) != 0 )
+			throw std::runtime_error( "Unable to create " + dir );
+		dirs.push_back( dir );
+	}
+
+	for ( size_t i = 0; i != thePackages; ++i )
+	{
+		std::string n = pkgName( i );
+		std::ofstream f( dirs[i % theDirs] + "/" + n + ".pc" );
+		f << "prefix=/opt/" << n << "\n"
+		  << "exec_prefix=${prefix}\n"
+		  << "libdir=${exec_prefix}/lib\n"
+		  << "includedir=${prefix}/include\n\n"
+		  << "Name: " << n << "\n"
+		  << "Description: synthetic package " << i << "\n"
+		  << "Version: 1." << ( i % 10 ) << ".0\n";
+		if ( i >= 2 * theDirs )
+			f << "Requires: " << pkgName( i - theDirs ) << " >= 1.0, " << pkgName( i - 2 * theDirs ) << "\n";
+		f << "Libs: -L${libdir} -l" << n << "\n"
+		  << "Cflags: -I${includedir} -DHAVE_" << i << "=1\n";
+		if ( ! f )
+			throw std::runtime_error( "Unable to write " + n + ".pc" );
+	}
+}
+
+void
+removeTree( const std::string &root, const std::vector<std::string> &dirs )
+{
+	for ( size_t i = 0; i != thePackages; ++i )
+		::unlink( ( dirs[i % theDirs] + "/" + pkgName( i ) + ".pc" ).c_str() );
+	for ( auto &d: dirs )
+		::rmdir( d.c_str() );
+	::rmdir( root.c_str() );
+}
+
+// resolves packages first, first + step, ... through a fresh set
+size_t
+resolve( const std::string &sys, const std::string &path, size_t first, size_t step )
+{
+	PackageSet &ps = PackageSet::get( sys );
+	ps.setPackageSearchPath( path );
+	size_t found = 0;
+	for ( size_t i = first; i < thePackages; i += step )
+	{
+		if ( ps.find( pkgName( i ) ) )
+			++found;
+	}
+	return found;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+int
+main( int argc, char *argv[] )
+{
+	// the thread count may be given, defaulting to the hardware threads
+	if ( argc > 1 )
+		ThreadPool::setThreadCount( size_t( atoi( argv[1] ) ) );
+
+	char tmpl[] = "/tmp/package-bench.XXXXXX";
+	if ( ! ::mkdtemp( tmpl ) )
+	{
+		std::cerr << "ERROR: unable to create a temporary directory" << std::endl;
+		return 1;
+	}
+	std::string root( tmpl );
+	std::vector<std::string> dirs;
+	int ret = 0;
+	try
+	{
+		writeTree( root, dirs );
+		std::string allDirs;
+		for ( auto &d: dirs )
+		{
+			if ( ! allDirs.empty() )
+				allDirs.push_back( ':' );
+			allDirs.append( d );
+		}
+
+		std::cout << "packages " << thePackages << ", dirs " << theDirs
+				  << ", threads " << ThreadPool::threadCount() << std::endl;
+		std::cout << " round serial ms parallel ms" << std::endl;
+		for ( size_t r = 0; r != theRounds; ++r )
+		{
+			// every round uses new system names so each set starts cold
+			std::string tag = std::to_string( r );
+			auto start = Clock::now();
+			size_t serialFound = resolve( "serial" + tag, allDirs, 0, 1 );
+			double serialMs = msSince( start );
+
+			std::vector<size_t> found( theDirs, 0 );
+			start = Clock::now();
+			{
+				TaskGroup tg;
+				for ( size_t d = 0; d != theDirs; ++d )
+				{
+					tg.run( [&, d]() {
+							found[d] = resolve( "parallel" + tag + "." + std::to_string( d ), dirs[d], d, theDirs );
+						} );
+				}
+				tg.wait();
+			}
+			double parallelMs = msSince( start );
+
+			size_t parallelFound = 0;
+			for ( size_t f: found )
+				parallelFound += f;
+			if ( serialFound != thePackages || parallelFound != thePackages )
+			{
+				std::cerr << "ERROR: serial found " << serialFound << " packages, parallel found "
+						  << parallelFound << " of " << thePackages << std::endl;
+				ret = 1;
+				break;
+			}
+
+			std::cout << std::setw( 6 ) << r
+					  << std::setw( 10 ) << std::fixed << std::setprecision( 2 ) << serialMs
+					  << std::setw( 12 ) << parallelMs << std::endl;
+		}
+	}
+	catch ( std::exception &e )
+	{
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		ret = 1;
+	}
+	removeTree( root, dirs );
+	return ret;
+}
@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "TransformSet.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <algorithm>
+
+
+////////////////////////////////////////
+
+
+// The transform memo hot path: every Item::transform starts by asking
+// the scope for an existing transform of the item id, missing the
+// first time and hitting each time the item is reached again as a
+// dependency. Ids come from one global counter shared by every scope,
+// so each scope sees a sparse, mostly increasing subset. Runs the
+// same sequence against the TransformSet table and against the
+// std::map it replaced.
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince( Clock::time_point s )
+{
+	return std::chrono::duration<double, std::milli>( Clock::now() - s ).count();
+}
+
+const size_t theHitsPerItem = 4;
+
+struct MapMemo
+{
+	std::shared_ptr<BuildItem> getTransform( uint64_t id ) const
+	{
+		auto i = myMap.find( id );
+		if ( i != myMap.end() )
+			return i->second;
+		return std::shared_ptr<BuildItem>();
+	}
+	void recordTransform( uint64_t id, const std::shared_ptr<BuildItem> &bi )
+	{
+		myItems.push_back( bi );
+		myMap[id] = bi;
+	}
+
+	std::vector< std::shared_ptr<BuildItem> > myItems;
+	std::map< uint64_t, std::shared_ptr<BuildItem> > myMap;
+};
+
+template <typename Memo>
+double
+runMemo( Memo &m, const std::vector<uint64_t> &ids,
+		 const std::vector<uint64_t> &lookups,
+		 const std::vector< std::shared_ptr<BuildItem> > &items,
+		 size_t &found )
+{
+	auto start = Clock::now();
+	for ( size_t i = 0; i != ids.size(); ++i )
+	{
+		if ( ! m.getTransform( ids[i] ) )
+			m.recordTransform( ids[i], items[i] );
+	}
+	for ( uint64_t id: lookups )
+	{
+		if ( m.getTransform( id ) )
+			++found;
+	}
+	return msSince( start );
+}
+
+void
+runSize( size_t n, const std::shared_ptr<Directory> &dir )
+{
+	std::mt19937_64 rng( n );
+	std::vector<uint64_t> ids( n );
+	uint64_t id = 1;
+	for ( size_t i = 0; i != n; ++i )
+	{
+		id += 1 + rng() % 3;
+		ids[i] = id;
+	}
+
+	std::vector< std::shared_ptr<BuildItem> > items;
+	items.reserve( n );
+	for ( size_t i = 0; i != n; ++i )
+		items.push_back( std::make_shared<BuildItem>( "item" + std::to_string( i ), dir ) );
+
+	// mostly items transformed recently (the next library over),
+	// some anywhere in the scope, and a few that belong to another
+	// scope and miss
+	std::vector<uint64_t> lookups;
+	lookups.reserve( n * theHitsPerItem );
+	for ( size_t i = 0; i != n * theHitsPerItem; ++i )
+	{
+		size_t r = rng() % 10;
+		size_t at = i / theHitsPerItem;
+		if ( r < 6 )
+			lookups.push_back( ids[at - std::min( at, size_t( rng() % 64 ) )] );
+		else if ( r < 9 )
+			lookups.push_back( ids[rng() % n] );
+		else
+			lookups.push_back( ids[rng() % n] + 1 );
+	}
+
+	size_t mapFound = 0, tableFound = 0;
+	double mapMs, tableMs;
+	{
+		MapMemo m;
+		mapMs = runMemo( m, ids, lookups, items, mapFound );
+	}
+	{
+		TransformSet ts( dir, "Linux" );
+		tableMs = runMemo( ts, ids, lookups, items, tableFound );
+	}
+	if ( mapFound != tableFound )
+	{
+		std::cerr << "ERROR: map found " << mapFound << " transforms, table found " << tableFound << std::endl;
+		exit( 1 );
+	}
+
+	double ops = double( n + lookups.size() );
+	std::cout << std::setw( 8 ) << n
+			  << std::setw( 10 ) << lookups.size()
+			  << std::setw( 10 ) << std::fixed << std::setprecision( 2 ) << mapMs
+			  << std::setw( 8 ) << std::setprecision( 1 ) << ( mapMs * 1e6 / ops )
+			  << std::setw( 10 ) << std::setprecision( 2 ) << tableMs
+			  << std::setw( 8 ) << std::setprecision( 1 ) << ( tableMs * 1e6 / ops )
+			  << std::endl;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+int
+main( void )
+{
+	std::shared_ptr<Directory> dir = std::make_shared<Directory>( "/tmp/transform-bench" );
+
+	std::cout << "   items   lookups    map ms   ns/op  table ms   ns/op" << std::endl;
+	for ( size_t n = 1000; n <= 256000; n *= 4 )
+		runSize( n, dir );
+	return 0;
+}
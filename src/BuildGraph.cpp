@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "BuildGraph.h"
+
+#include "BuildItem.h"
+#include "CacheData.h"
+#include <unordered_map>
+
+
+////////////////////////////////////////
+
+
+BuildGraph::BuildGraph( void )
+{
+}
+
+
+////////////////////////////////////////
+
+
+BuildGraph::~BuildGraph( void )
+{
+}
+
+
+////////////////////////////////////////
+
+
+void
+BuildGraph::build( const std::vector< std::shared_ptr<BuildItem> > &items )
+{
+	myNodes = items;
+	myItemCount = items.size();
+	myOffsets.clear();
+	myEdges.clear();
+
+	std::unordered_map<const BuildItem *, NodeID> ids;
+	ids.reserve( items.size() * 2 );
+	for ( size_t i = 0; i != items.size(); ++i )
+		ids.emplace( items[i].get(), static_cast<NodeID>( i ) );
+
+	// the node list grows as we find dependencies outside the
+	// transform set, so index rather than iterate
+	myOffsets.reserve( items.size() * theTypeCount + 1 );
+	for ( size_t n = 0; n != myNodes.size(); ++n )
+	{
+		std::shared_ptr<BuildItem> bi = myNodes[n];
+		for ( size_t t = 0; t != theTypeCount; ++t )
+		{
+			myOffsets.push_back( static_cast<uint32_t>( myEdges.size() ) );
+			for ( auto &d: bi->dependencies( static_cast<DependencyType>( t ) ) )
+			{
+				auto id = ids.emplace( d.get(), static_cast<NodeID>( myNodes.size() ) );
+				if ( id.second )
+					myNodes.push_back( d );
+				myEdges.push_back( id.first->second );
+			}
+		}
+	}
+	myOffsets.push_back( static_cast<uint32_t>( myEdges.size() ) );
+}
+
+
+////////////////////////////////////////
+
+
+void
+BuildGraph::serialize( std::string &out ) const
+{
+	CacheData::put( out, myOffsets );
+	CacheData::put( out, myEdges );
+}
+
+
+////////////////////////////////////////
+
+
+bool
+BuildGraph::deserialize( CacheData::Reader &rdr,
+						 std::vector< std::shared_ptr<BuildItem> > nodes,
+						 size_t itemCount )
+{
+	std::vector<uint32_t> offsets;
+	std::vector<NodeID> edges;
+	if ( ! rdr.get( offsets ) || ! rdr.get( edges ) ||
+		 itemCount > nodes.size() ||
+		 offsets.size() != nodes.size() * theTypeCount + 1 ||
+		 offsets.front() != 0 || offsets.back() != edges.size() )
+		return false;
+	for ( size_t i = 1; i != offsets.size(); ++i )
+	{
+		if ( offsets[i] < offsets[i - 1] )
+			return false;
+	}
+	for ( NodeID e: edges )
+	{
+		if ( e >= nodes.size() )
+			return false;
+	}
+
+	myNodes = std::move( nodes );
+	myItemCount = itemCount;
+	myOffsets = std::move( offsets );
+	myEdges = std::move( edges );
+	return true;
+}
+
@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <string>
+
+#include "Dependency.h"
+
+
+////////////////////////////////////////
+
+class BuildItem;
+namespace CacheData { class Reader; }
+
+/// @brief Class BuildGraph is the frozen form of the build items of
+///        a transform set.
+///
+/// Once a scope has been transformed, the build items no longer
+/// change, so the generators don't need the per-item dependency
+/// maps. Each build item reachable from the transform set is given a
+/// dense integer id - the items of the transform set first, in order,
+/// followed by any other dependencies in the order found - and the
+/// dependencies are stored as a single array of ids with offsets per
+/// item and dependency type (compressed sparse row). The lists are
+/// in the same (sorted) order as BuildItem::dependencies.
+class BuildGraph
+{
+public:
+	typedef uint32_t NodeID;
+
+	class EdgeRange
+	{
+	public:
+		EdgeRange( const NodeID *b, const NodeID *e ) : myBegin( b ), myEnd( e ) {}
+
+		const NodeID *begin( void ) const { return myBegin; }
+		const NodeID *end( void ) const { return myEnd; }
+		bool empty( void ) const { return myBegin == myEnd; }
+		size_t size( void ) const { return static_cast<size_t>( myEnd - myBegin ); }
+
+	private:
+		const NodeID *myBegin;
+		const NodeID *myEnd;
+	};
+
+	BuildGraph( void );
+	~BuildGraph( void );
+
+	void build( const std::vector< std::shared_ptr<BuildItem> > &items );
+
+	/// writes the edges for the build graph cache, the nodes
+	/// themselves are left to the transform set
+	void serialize( std::string &out ) const;
+	/// restores the edges written by serialize for the given nodes,
+	/// returning false if they don't fit
+	bool deserialize( CacheData::Reader &rdr,
+					  std::vector< std::shared_ptr<BuildItem> > nodes,
+					  size_t itemCount );
+
+	/// number of items from the transform set
+	inline size_t itemCount( void ) const;
+	/// number of items including the dependencies outside the
+	/// transform set
+	inline size_t size( void ) const;
+
+	inline const std::shared_ptr<BuildItem> &item( NodeID n ) const;
+	inline EdgeRange dependencies( NodeID n, DependencyType dt ) const;
+
+private:
+	static const size_t theTypeCount = 4;
+
+	std::vector< std::shared_ptr<BuildItem> > myNodes;
+	size_t myItemCount = 0;
+	std::vector<uint32_t> myOffsets;
+	std::vector<NodeID> myEdges;
+};
+
+
+////////////////////////////////////////
+
+
+inline size_t
+BuildGraph::itemCount( void ) const
+{
+	return myItemCount;
+}
+
+
+////////////////////////////////////////
+
+
+inline size_t
+BuildGraph::size( void ) const
+{
+	return myNodes.size();
+}
+
+
+////////////////////////////////////////
+
+
+inline const std::shared_ptr<BuildItem> &
+BuildGraph::item( NodeID n ) const
+{
+	return myNodes[n];
+}
+
+
+////////////////////////////////////////
+
+
+inline BuildGraph::EdgeRange
+BuildGraph::dependencies( NodeID n, DependencyType dt ) const
+{
+	size_t o = n * theTypeCount + static_cast<size_t>( dt );
+	const NodeID *e = myEdges.data();
+	return EdgeRange( e + myOffsets[o], e + myOffsets[o + 1] );
+}
+
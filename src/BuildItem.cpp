@@ -43,7 +43,7 @@ BuildItem::BuildItem( const std::string &name,
 
 BuildItem::BuildItem( std::string &&name,
 					  const std::shared_ptr<Directory> &srcdir )
-		: myName( std::move( name ) ), myDirectory( srcdir )
+		: myName( name ), myDirectory( srcdir )
 {
 }
 
@@ -62,7 +62,10 @@ BuildItem::~BuildItem( void )
 void
 BuildItem::setName( const std::string &n )
 {
-	myName = n;
+	// the dependency lists of other items are sorted by name
+	if ( ! myDependents.empty() )
+		throw std::runtime_error( "Unable to rename '" + getName() + "' to '" + n + "' once it is a dependency" );
+	myName = Symbol( n );
 }
 
 
@@ -72,7 +75,7 @@ BuildItem::setName( const std::string &n )
 const std::string &
 BuildItem::getName( void ) const
 {
-	return myName;
+	return myName.str();
 }
 
 
@@ -127,7 +130,7 @@ BuildItem::extractTags( std::set<std::string> &tags ) const
 		tags.insert( myTool->getTag() );
 	else
 	{
-		std::vector<ItemPtr> deps = extractDependencies( DependencyType::EXPLICIT );
+		const std::vector<ItemPtr> &deps = dependencies( DependencyType::EXPLICIT );
 		if ( deps.empty() )
 			VERBOSE( getName() << " has no explicit dependencies" );
 		for ( const ItemPtr &i: deps )
@@ -222,7 +225,7 @@ BuildItem::addToVariable( const std::string &name, const Variable &val )
 {
 	auto i = myVariables.find( name );
 	if ( i != myVariables.end() )
-		i->second.moveToEnd( val.values() );
+		i->second.moveToEnd( val );
 	else
 	{
 		auto ni = myVariables.emplace( std::make_pair( name, Variable( val ) ) );
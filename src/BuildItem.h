@@ -26,6 +26,7 @@
 #include <map>
 #include "Dependency.h"
 #include "Tool.h"
+#include "Symbol.h"
 
 class TransformSet;
 
@@ -85,7 +86,7 @@ public:
 
 	bool flatten( const std::shared_ptr<BuildItem> &i );
 private:
-	std::string myName;
+	Symbol myName;
 	std::string myPseudoName;
 
 	std::shared_ptr<Tool> myTool;
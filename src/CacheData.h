@@ -0,0 +1,274 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <deque>
+#include <memory>
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Encoding for the binary files kept in the cache directory
+///
+/// Integers are written in native byte order and strings with a
+/// length prefix. The files are only ever read back by the same
+/// binary on the same machine, and anything unreadable (i.e. a
+/// truncated write) just fails the read so the cache is rebuilt.
+///
+namespace CacheData
+{
+
+inline void put( std::string &out, int64_t v )
+{
+	out.append( reinterpret_cast<const char *>( &v ), sizeof(v) );
+}
+
+inline void put( std::string &out, const std::string &v )
+{
+	put( out, static_cast<int64_t>( v.size() ) );
+	out.append( v );
+}
+
+inline void put( std::string &out, const std::map<std::string, std::string> &m )
+{
+	put( out, static_cast<int64_t>( m.size() ) );
+	for ( auto &i: m )
+	{
+		put( out, i.first );
+		put( out, i.second );
+	}
+}
+
+inline void put( std::string &out, const std::vector<std::string> &v )
+{
+	put( out, static_cast<int64_t>( v.size() ) );
+	for ( auto &i: v )
+		put( out, i );
+}
+
+inline void put( std::string &out, const std::vector<uint32_t> &v )
+{
+	put( out, static_cast<int64_t>( v.size() ) );
+	if ( ! v.empty() )
+		out.append( reinterpret_cast<const char *>( v.data() ), v.size() * sizeof(uint32_t) );
+}
+
+class Reader
+{
+public:
+	Reader( const std::string &d, size_t pos = 0 ) : myData( d ), myPos( pos ) {}
+
+	inline bool atEnd( void ) const { return myPos == myData.size(); }
+
+	bool get( int64_t &v )
+	{
+		if ( myData.size() - myPos < sizeof(v) )
+			return false;
+		memcpy( &v, myData.data() + myPos, sizeof(v) );
+		myPos += sizeof(v);
+		return true;
+	}
+
+	bool get( std::string &v )
+	{
+		int64_t n;
+		if ( ! get( n ) || n < 0 || myData.size() - myPos < static_cast<size_t>( n ) )
+			return false;
+		v.assign( myData, myPos, static_cast<size_t>( n ) );
+		myPos += static_cast<size_t>( n );
+		return true;
+	}
+
+	bool get( std::map<std::string, std::string> &m )
+	{
+		int64_t n;
+		if ( ! get( n ) )
+			return false;
+		std::string k, v;
+		for ( int64_t i = 0; i < n; ++i )
+		{
+			if ( ! get( k ) || ! get( v ) )
+				return false;
+			m[k] = v;
+		}
+		return true;
+	}
+
+	bool get( std::vector<std::string> &v )
+	{
+		int64_t n;
+		if ( ! get( n ) || n < 0 )
+			return false;
+		std::string s;
+		for ( int64_t i = 0; i < n; ++i )
+		{
+			if ( ! get( s ) )
+				return false;
+			v.emplace_back( std::move( s ) );
+		}
+		return true;
+	}
+
+	bool get( std::vector<uint32_t> &v )
+	{
+		int64_t n;
+		if ( ! get( n ) || n < 0 ||
+			 ( myData.size() - myPos ) / sizeof(uint32_t) < static_cast<size_t>( n ) )
+			return false;
+		v.resize( static_cast<size_t>( n ) );
+		if ( n > 0 )
+			memcpy( v.data(), myData.data() + myPos, v.size() * sizeof(uint32_t) );
+		myPos += v.size() * sizeof(uint32_t);
+		return true;
+	}
+
+private:
+	const std::string &myData;
+	size_t myPos;
+};
+
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Writes strings as indices into a table of the distinct
+/// strings, for data where the same strings (paths, flags) repeat a
+/// lot. The table has to be written ahead of the data using it.
+///
+class StringWriter
+{
+public:
+	void put( std::string &out, const std::string &s )
+	{
+		auto i = myIndex.emplace( s, static_cast<int64_t>( myStrings.size() ) );
+		if ( i.second )
+			myStrings.push_back( &( i.first->first ) );
+		CacheData::put( out, i.first->second );
+	}
+
+	void put( std::string &out, const std::vector<std::string> &v )
+	{
+		CacheData::put( out, static_cast<int64_t>( v.size() ) );
+		for ( auto &i: v )
+			put( out, i );
+	}
+
+	/// writes a reference to storage shared by several records,
+	/// returning true the first time it is seen (or it is null) so
+	/// the caller writes the contents
+	bool putShared( std::string &out, const void *obj )
+	{
+		if ( ! obj )
+		{
+			CacheData::put( out, static_cast<int64_t>( -2 ) );
+			return true;
+		}
+		auto i = myShared.emplace( obj, static_cast<int64_t>( myShared.size() ) );
+		CacheData::put( out, i.second ? static_cast<int64_t>( -1 ) : i.first->second );
+		return i.second;
+	}
+
+	void write( std::string &out ) const
+	{
+		CacheData::put( out, static_cast<int64_t>( myStrings.size() ) );
+		for ( const std::string *s: myStrings )
+			CacheData::put( out, *s );
+	}
+
+private:
+	std::unordered_map<std::string, int64_t> myIndex;
+	std::vector<const std::string *> myStrings;
+	std::unordered_map<const void *, int64_t> myShared;
+};
+
+class StringReader
+{
+public:
+	bool load( Reader &rdr )
+	{
+		return rdr.get( myStrings );
+	}
+
+	bool get( Reader &rdr, std::string &s ) const
+	{
+		int64_t i;
+		if ( ! rdr.get( i ) || i < 0 || static_cast<size_t>( i ) >= myStrings.size() )
+			return false;
+		s = myStrings[static_cast<size_t>( i )];
+		return true;
+	}
+
+	bool get( Reader &rdr, std::vector<std::string> &v ) const
+	{
+		int64_t n;
+		if ( ! rdr.get( n ) || n < 0 )
+			return false;
+		std::string s;
+		for ( int64_t i = 0; i < n; ++i )
+		{
+			if ( ! get( rdr, s ) )
+				return false;
+			v.emplace_back( std::move( s ) );
+		}
+		return true;
+	}
+
+	/// reads what putShared wrote. slot is where the caller keeps
+	/// what it reads for the later references (null if it isn't
+	/// shared), isNew is true if the contents follow
+	bool getShared( Reader &rdr, std::shared_ptr<void> *&slot, bool &isNew ) const
+	{
+		int64_t i;
+		if ( ! rdr.get( i ) || i < -2 || i >= static_cast<int64_t>( myShared.size() ) )
+			return false;
+		isNew = ( i < 0 );
+		if ( i == -2 )
+			slot = nullptr;
+		else if ( i == -1 )
+		{
+			myShared.emplace_back();
+			slot = &( myShared.back() );
+		}
+		else
+			slot = &( myShared[static_cast<size_t>( i )] );
+		return true;
+	}
+
+private:
+	std::vector<std::string> myStrings;
+	// std::deque so the slots handed out stay put
+	mutable std::deque< std::shared_ptr<void> > myShared;
+};
+
+} // namespace CacheData
+
@@ -323,7 +323,7 @@ CompileSet::fillBuildItem( const std::shared_ptr<BuildItem> &bi, TransformSet &x
 	
 	followChains( chainsToCheck, tags, bi, xform );
 
-	std::vector< std::shared_ptr<BuildItem> > expDeps = bi->extractDependencies( DependencyType::EXPLICIT );
+	const std::vector< std::shared_ptr<BuildItem> > &expDeps = bi->dependencies( DependencyType::EXPLICIT );
 	for ( const auto &compItem: expDeps )
 	{
 		if ( !outflags.empty() )
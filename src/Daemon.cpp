@@ -0,0 +1,426 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "Daemon.h"
+#include "GlobManifest.h"
+#include "FileUtil.h"
+#include "ScopeGuard.h"
+#include "Debug.h"
+
+#include <stdexcept>
+#include <system_error>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef __linux__
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/inotify.h>
+#endif
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+#ifdef __linux__
+
+static volatile sig_atomic_t theStop = 0;
+
+static void
+stopHandler( int )
+{
+	theStop = 1;
+}
+
+static std::string
+socketPath( void )
+{
+	return File::getCacheDirectory() + File::pathSeparator() + "daemon.sock";
+}
+
+static bool
+makeAddress( struct sockaddr_un &addr )
+{
+	std::string p = socketPath();
+	if ( File::getCacheDirectory().empty() || p.size() >= sizeof(addr.sun_path) )
+		return false;
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	memcpy( addr.sun_path, p.c_str(), p.size() + 1 );
+	return true;
+}
+
+static int
+connectDaemon( void )
+{
+	struct sockaddr_un addr;
+	if ( ! makeAddress( addr ) )
+		return -1;
+
+	int fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+	if ( fd < 0 )
+		return -1;
+	if ( ::connect( fd, reinterpret_cast<struct sockaddr *>( &addr ), sizeof(addr) ) != 0 )
+	{
+		::close( fd );
+		return -1;
+	}
+	return fd;
+}
+
+static bool
+writeAll( int fd, const std::string &s )
+{
+	size_t pos = 0;
+	while ( pos < s.size() )
+	{
+		ssize_t nw = ::send( fd, s.data() + pos, s.size() - pos, MSG_NOSIGNAL );
+		if ( nw < 0 && errno == EINTR )
+			continue;
+		if ( nw <= 0 )
+			return false;
+		pos += static_cast<size_t>( nw );
+	}
+	return true;
+}
+
+static bool
+readLine( int fd, std::string &line )
+{
+	line.clear();
+	while ( true )
+	{
+		char c;
+		ssize_t nr = ::read( fd, &c, 1 );
+		if ( nr < 0 && errno == EINTR )
+			continue;
+		if ( nr <= 0 )
+			return false;
+		if ( c == '\n' )
+			return true;
+		line.push_back( c );
+	}
+}
+
+// runs a check (or, when forced, a full regeneration) in a child
+// process, returning the exit status
+static int
+runChild( const std::string &cmdline, const std::function<int(void)> &generate, bool force )
+{
+	std::cout.flush();
+	std::cerr.flush();
+	pid_t pid = ::fork();
+	if ( pid < 0 )
+		throw std::system_error( errno, std::system_category(), "forking to regenerate" );
+
+	if ( pid == 0 )
+	{
+		int rc = 1;
+		try
+		{
+			if ( ! force && GlobManifest::upToDate( cmdline ) )
+				rc = 0;
+			else
+				rc = generate();
+		}
+		catch ( std::exception &e )
+		{
+			std::cerr << "ERROR: " << e.what() << std::endl;
+		}
+		catch ( ... )
+		{
+			std::cerr << "Unhandled exception" << std::endl;
+		}
+		std::cout.flush();
+		std::cerr.flush();
+		::_exit( rc );
+	}
+
+	int status = 0;
+	while ( ::waitpid( pid, &status, 0 ) < 0 )
+	{
+		if ( errno != EINTR )
+			return 1;
+	}
+	return WIFEXITED( status ) ? WEXITSTATUS( status ) : 1;
+}
+
+struct Watches
+{
+	int fd = -1;
+	// watch descriptor to the names in that directory we care about
+	std::map<int, std::set<std::string>> names;
+	// directories where any change matters (searched by a glob)
+	std::set<int> anyName;
+};
+
+static void
+addWatch( Watches &w, const std::string &dir, const std::string &name )
+{
+	const uint32_t mask = ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+							IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF );
+	int wd = ::inotify_add_watch( w.fd, dir.c_str(), mask );
+	if ( wd < 0 )
+	{
+		VERBOSE( "Unable to watch " << dir << ": " << strerror( errno ) );
+		return;
+	}
+	if ( name.empty() )
+		w.anyName.insert( wd );
+	else
+		w.names[wd].insert( name );
+}
+
+// (re-)creates the watches from the manifest the last run wrote. A
+// fresh inotify instance also drops the events from our own writes
+static void
+watch( Watches &w, const std::string &cmdline )
+{
+	if ( w.fd >= 0 )
+		::close( w.fd );
+	w.names.clear();
+	w.anyName.clear();
+	w.fd = ::inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( w.fd < 0 )
+		throw std::system_error( errno, std::system_category(), "initializing inotify" );
+
+	std::vector<std::string> files, dirs;
+	if ( ! GlobManifest::watchList( cmdline, files, dirs ) )
+	{
+		WARNING( "No build manifest to watch, waiting for a request" );
+		return;
+	}
+
+	for ( const std::string &d: dirs )
+		addWatch( w, d, std::string() );
+	for ( const std::string &f: files )
+	{
+		struct stat sb;
+		std::string::size_type sep = f.find_last_of( File::pathSeparator() );
+		if ( ( ::stat( f.c_str(), &sb ) == 0 && S_ISDIR( sb.st_mode ) ) ||
+			 sep == std::string::npos )
+			addWatch( w, f, std::string() );
+		else
+		{
+			// watch the directory, editors often replace a file
+			// by renaming a new one over it
+			addWatch( w, sep == 0 ? std::string( 1, File::pathSeparator() ) : f.substr( 0, sep ), f.substr( sep + 1 ) );
+		}
+	}
+	VERBOSE( "Watching " << files.size() << " files and " << dirs.size() << " directories" );
+}
+
+// reads any pending events, returning true if one matters
+static bool
+drain( Watches &w )
+{
+	bool ret = false;
+	alignas(struct inotify_event) char buf[16384];
+	while ( true )
+	{
+		ssize_t n = ::read( w.fd, buf, sizeof(buf) );
+		if ( n < 0 && errno == EINTR )
+			continue;
+		if ( n <= 0 )
+			break;
+
+		for ( ssize_t off = 0; off < n; )
+		{
+			const struct inotify_event *ev = reinterpret_cast<const struct inotify_event *>( buf + off );
+			off += static_cast<ssize_t>( sizeof(struct inotify_event) + ev->len );
+
+			if ( ev->mask & ( IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF ) )
+				ret = true;
+			else if ( w.anyName.find( ev->wd ) != w.anyName.end() )
+				ret = true;
+			else if ( ev->len > 0 )
+			{
+				auto i = w.names.find( ev->wd );
+				if ( i != w.names.end() && i->second.find( ev->name ) != i->second.end() )
+				{
+					VERBOSE( "Change to " << ev->name );
+					ret = true;
+				}
+			}
+		}
+	}
+	return ret;
+}
+
+#endif
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+namespace Daemon
+{
+
+
+////////////////////////////////////////
+
+
+int
+run( const std::string &cmdline, const std::function<int(void)> &generate )
+{
+#ifdef __linux__
+	struct sockaddr_un addr;
+	if ( ! makeAddress( addr ) )
+		throw std::runtime_error( "Unable to place the daemon socket in the cache directory " + File::getCacheDirectory() );
+
+	int probe = connectDaemon();
+	if ( probe >= 0 )
+	{
+		::close( probe );
+		throw std::runtime_error( "A daemon is already running for this build directory" );
+	}
+
+	::mkdir( File::getCacheDirectory().c_str(), 0777 );
+	::unlink( addr.sun_path );
+	int lfd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+	if ( lfd < 0 )
+		throw std::system_error( errno, std::system_category(), "creating daemon socket" );
+	ON_EXIT{ ::close( lfd ); };
+	if ( ::bind( lfd, reinterpret_cast<struct sockaddr *>( &addr ), sizeof(addr) ) != 0 ||
+		 ::listen( lfd, 8 ) != 0 )
+		throw std::system_error( errno, std::system_category(), "listening on daemon socket" );
+	ON_EXIT{ ::unlink( socketPath().c_str() ); };
+
+	struct sigaction sa;
+	memset( &sa, 0, sizeof(sa) );
+	sa.sa_handler = &stopHandler;
+	::sigaction( SIGINT, &sa, nullptr );
+	::sigaction( SIGTERM, &sa, nullptr );
+	::signal( SIGPIPE, SIG_IGN );
+
+	int rc = runChild( cmdline, generate, true );
+	Watches w;
+	ON_EXIT{ if ( w.fd >= 0 ) ::close( w.fd ); };
+	watch( w, cmdline );
+	std::cout << "Watching for changes, listening on " << socketPath() << std::endl;
+
+	bool pending = false;
+	while ( ! theStop )
+	{
+		struct pollfd fds[2];
+		fds[0].fd = lfd;
+		fds[0].events = POLLIN;
+		fds[1].fd = w.fd;
+		fds[1].events = POLLIN;
+		// once something changed, wait for things to settle (editors
+		// and version control touch several files in a row)
+		int n = ::poll( fds, 2, pending ? 100 : -1 );
+		if ( n < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			throw std::system_error( errno, std::system_category(), "waiting for changes" );
+		}
+
+		if ( n == 0 )
+		{
+			pending = false;
+			rc = runChild( cmdline, generate, false );
+			watch( w, cmdline );
+			continue;
+		}
+
+		if ( ( fds[1].revents & POLLIN ) && drain( w ) )
+			pending = true;
+
+		if ( fds[0].revents & POLLIN )
+		{
+			int cfd = ::accept4( lfd, nullptr, nullptr, SOCK_CLOEXEC );
+			if ( cfd < 0 )
+				continue;
+			ON_EXIT{ ::close( cfd ); };
+
+			std::string req;
+			if ( ! readLine( cfd, req ) )
+				continue;
+			if ( req != cmdline )
+			{
+				writeAll( cfd, "no\n" );
+				continue;
+			}
+
+			// the build tool thinks something changed, whether or
+			// not we saw it
+			pending = false;
+			rc = runChild( cmdline, generate, false );
+			watch( w, cmdline );
+			writeAll( cfd, rc == 0 ? "ok\n" : "failed\n" );
+		}
+	}
+
+	return rc;
+#else
+	(void)cmdline;
+	(void)generate;
+	throw std::runtime_error( "The daemon is only supported on Linux" );
+#endif
+}
+
+
+////////////////////////////////////////
+
+
+bool
+request( const std::string &cmdline )
+{
+#ifdef __linux__
+	int fd = connectDaemon();
+	if ( fd < 0 )
+		return false;
+	ON_EXIT{ ::close( fd ); };
+
+	std::string reply;
+	if ( ! writeAll( fd, cmdline + '\n' ) || ! readLine( fd, reply ) )
+		return false;
+	return reply == "ok";
+#else
+	(void)cmdline;
+	return false;
+#endif
+}
+
+
+////////////////////////////////////////
+
+
+} // namespace Daemon
+
+
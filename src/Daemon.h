@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <string>
+#include <functional>
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Keeps the build files current in the background.
+///
+/// The daemon regenerates once, then watches the files the run
+/// visited (and the directories its globs searched) with inotify.
+/// When one changes, it checks the glob manifest and regenerates
+/// only if needed, so the build files are normally up to date before
+/// ninja or make look at them. A --regen run from the build files
+/// asks the daemon over a unix socket in the cache directory, and
+/// falls back to doing the work itself when no daemon is running.
+///
+/// Each regeneration runs in a forked child, since evaluating the
+/// construct files leaves global state (scopes, configurations, lua
+/// globals) that can't be reset. The child starts from the daemon's
+/// state, and the on-disk caches keep the evaluation itself warm.
+///
+namespace Daemon
+{
+
+/// runs until interrupted. generate is called (in a child process)
+/// to produce the build files, returning the exit status
+int run( const std::string &cmdline, const std::function<int(void)> &generate );
+
+/// asks a daemon for the same command line to bring the build files
+/// up to date, returning false if there is none (or it failed)
+bool request( const std::string &cmdline );
+
+} // namespace Daemon
+
+
@@ -69,5 +69,17 @@ void enable( bool d )
 } // Quiet
 
 
+////////////////////////////////////////
+
+
+namespace Stats
+{
+bool theStatsEnabled = false;
+
+void enable( bool d )
+{
+	theStatsEnabled = d;
+}
 
+} // Stats
 
@@ -59,6 +59,13 @@ inline bool on( void ) { return theQuietEnabled; }
 void enable( bool d );
 }
 
+namespace Stats
+{
+extern bool theStatsEnabled;
+inline bool on( void ) { return theStatsEnabled; }
+void enable( bool d );
+}
+
 #ifdef NDEBUG
 # define DEBUG( x )
 #else
@@ -66,6 +73,7 @@ void enable( bool d );
 #endif
 
 #define VERBOSE( x ) if ( Verbose::on() ) { std::cout << x << std::endl; }
+#define STATS( x ) if ( Stats::on() ) { std::cout << x << std::endl; }
 #define WARNING( x ) if ( ! Quiet::on() ) { std::cout << "WARNING: " << x << std::endl; }
 #define ERROR( x ) { std::cout << "ERROR: " << x << std::endl; }
 
@@ -26,6 +26,7 @@
 #include "Toolset.h"
 #include "Debug.h"
 #include <stdexcept>
+#include <mutex>
 
 
 ////////////////////////////////////////
@@ -118,8 +119,69 @@ Tool::OptionDefaultSet theVarPrefixes{
 ////////////////////////////////////////
 
 
+// what the default tool discovery found, in the order it was found
+// so every scope is set up the same as if it searched itself
+struct DefaultTools::Defaults
+{
+	std::vector< std::shared_ptr<Tool> > tools;
+	std::vector< std::shared_ptr<Toolset> > toolsets;
+	std::vector<std::string> enabled;
+
+	void addTool( const std::shared_ptr<Tool> &t ) { tools.push_back( t ); }
+	void addToolSet( const std::shared_ptr<Toolset> &ts ) { toolsets.push_back( ts ); }
+	void useToolSet( const std::string &n ) { enabled.push_back( n ); }
+};
+
+
+////////////////////////////////////////
+
+
 void
 DefaultTools::checkAndAddCFamilies( Scope &s )
+{
+	const Defaults &d = defaults();
+	for ( auto &t: d.tools )
+		s.addTool( t );
+	for ( auto &ts: d.toolsets )
+		s.addToolSet( ts );
+	for ( auto &n: d.enabled )
+		s.useToolSet( n );
+}
+
+
+////////////////////////////////////////
+
+
+bool
+DefaultTools::isShared( const Tool *t )
+{
+	for ( auto &dt: defaults().tools )
+	{
+		if ( dt.get() == t )
+			return true;
+	}
+	return false;
+}
+
+
+////////////////////////////////////////
+
+
+const DefaultTools::Defaults &
+DefaultTools::defaults( void )
+{
+	static Defaults theDefaults;
+	static std::once_flag theOnce;
+	std::call_once( theOnce, []() { discover( theDefaults ); } );
+	return theDefaults;
+}
+
+
+////////////////////////////////////////
+
+
+void
+DefaultTools::discover( Defaults &s )
 {
 #ifdef WIN32
 	throw std::runtime_error( "Not yet implemented" );
@@ -192,7 +254,7 @@ DefaultTools::getOptions( void )
 
 #ifdef WIN32
 std::shared_ptr<Toolset>
-DefaultTools::checkAndAddCl( Scope &s, const std::map<std::string, std::string> &exelist, bool regAsDefault )
+DefaultTools::checkAndAddCl( Defaults &s, const std::map<std::string, std::string> &exelist, bool regAsDefault )
 {
 	return std::shared_ptr<Toolset>();
 }
@@ -203,7 +265,7 @@ DefaultTools::checkAndAddCl( Scope &s, const std::map<std::string, std::string>
 
 
 std::shared_ptr<Toolset>
-DefaultTools::checkAndAddClang( Scope &s, const std::map<std::string, std::string> &exelist )
+DefaultTools::checkAndAddClang( Defaults &s, const std::map<std::string, std::string> &exelist )
 {
 	std::shared_ptr<Toolset> cTools = std::make_shared<Toolset>( "clang" );
 	cTools->setTag( "compile" );
@@ -328,7 +390,7 @@ DefaultTools::checkAndAddClang( Scope &s, const std::map<std::string, std::strin
 
 
 std::shared_ptr<Toolset>
-DefaultTools::checkAndAddGCC( Scope &s, const std::map<std::string, std::string> &exelist )
+DefaultTools::checkAndAddGCC( Defaults &s, const std::map<std::string, std::string> &exelist )
 {
 	std::shared_ptr<Toolset> cTools = std::make_shared<Toolset>( "gcc" );
 	cTools->setTag( "compile" );
@@ -433,7 +495,7 @@ DefaultTools::checkAndAddGCC( Scope &s, const std::map<std::string, std::string>
 
 
 std::shared_ptr<Toolset>
-DefaultTools::checkAndAddArchiver( Scope &s, const std::map<std::string, std::string> &exelist )
+DefaultTools::checkAndAddArchiver( Defaults &s, const std::map<std::string, std::string> &exelist )
 {
 	std::shared_ptr<Toolset> cTools = std::make_shared<Toolset>( "system_ar" );
 	cTools->setTag( "archive" );
@@ -492,7 +554,7 @@ DefaultTools::checkAndAddArchiver( Scope &s, const std::map<std::string, std::st
 
 
 void
-DefaultTools::addSelfGenerator( Scope &s )
+DefaultTools::addSelfGenerator( Defaults &s )
 {
 	std::string selfTool;
 	bool haveSelf = File::findExecutable( selfTool, File::getArgv0() );
@@ -32,26 +32,38 @@
 
 
 class Scope;
+class Tool;
 class Toolset;
 
 class DefaultTools
 {
 public:
+	/// adds the default tools and toolsets to the scope. These are
+	/// only discovered once, and the same (read only) Tool objects
+	/// are shared by every scope
 	static void checkAndAddCFamilies( Scope &s );
 
+	/// true if the tool is one of the shared defaults, which has to
+	/// be copied before being modified
+	static bool isShared( const Tool *t );
+
 	/// returns the available default tool options which are then
 	/// exposed as functions to modify the current configuration or
 	/// top level scope
 	static const std::vector<std::string> &getOptions( void );
 
 protected:
+	struct Defaults;
+	static const Defaults &defaults( void );
+	static void discover( Defaults &s );
+
 #ifdef WIN32
-	static std::shared_ptr<Toolset> checkAndAddCl( Scope &s, const std::map<std::string, std::string> &exelist );
+	static std::shared_ptr<Toolset> checkAndAddCl( Defaults &s, const std::map<std::string, std::string> &exelist );
 #endif
-	static std::shared_ptr<Toolset> checkAndAddClang( Scope &s, const std::map<std::string, std::string> &exelist );
-	static std::shared_ptr<Toolset> checkAndAddGCC( Scope &s, const std::map<std::string, std::string> &exelist );
-	static std::shared_ptr<Toolset> checkAndAddArchiver( Scope &s, const std::map<std::string, std::string> &exelist );
-	static void addSelfGenerator( Scope &s );
+	static std::shared_ptr<Toolset> checkAndAddClang( Defaults &s, const std::map<std::string, std::string> &exelist );
+	static std::shared_ptr<Toolset> checkAndAddGCC( Defaults &s, const std::map<std::string, std::string> &exelist );
+	static std::shared_ptr<Toolset> checkAndAddArchiver( Defaults &s, const std::map<std::string, std::string> &exelist );
+	static void addSelfGenerator( Defaults &s );
 };
 
 
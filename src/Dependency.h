@@ -27,6 +27,9 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
+#include <mutex>
+#include <atomic>
+#include "ThreadPool.h"
 
 
 ////////////////////////////////////////
@@ -40,6 +43,15 @@ enum class DependencyType : uint8_t
 	ORDER
 };
 
+/// whether the graph of an item type may be changed from several
+/// threads at once, and so needs the graph lock. Types whose items
+/// are shared between threads (i.e. package configs) specialize this
+template <typename Item>
+struct DependencyTraits
+{
+	static const bool sharedGraph = false;
+};
+
 template <typename Item>
 class Dependency : public std::enable_shared_from_this<Item>
 {
@@ -47,10 +59,8 @@ public:
 	typedef std::shared_ptr<Item> ItemPtr;
 	typedef std::weak_ptr<Item> WeakItemPtr;
 
-	Dependency( void )
-	{}
-	virtual ~Dependency( void )
-	{}
+	inline Dependency( void );
+	inline virtual ~Dependency( void );
 
 	virtual const std::string &getName( void ) const = 0;
 
@@ -63,37 +73,143 @@ public:
 	/// the other passed in
 	inline bool hasDependency( const ItemPtr &other ) const;
 
-	/// for a chain dependency,
-	/// Recursively traverses the chain dependencies and
-	/// constructs a list of them. if an item has 2 chain dependencies
-	/// and both depend on a 3rd item, that 3rd item will appear
-	/// later than any of the items that depend on it
+	/// for a chain dependency, recursively traverses the chain
+	/// dependencies and returns all the items reachable, each
+	/// appearing once
 	///
 	/// for all other dependency types,
 	/// returns the list of items that this item has that dependency type on
+	///
+	/// In both cases, the list is sorted by name (and then directory,
+	/// then the order the items were created) so the generated output
+	/// is stable. Lists are sorted as edges are added, so an item's
+	/// name and directory must not change once it is a dependency of
+	/// another item. The returned reference is
+	/// valid until another dependency is added to this item (or any
+	/// of its chain dependencies)
+	inline const std::vector<ItemPtr> &dependencies( DependencyType dt ) const;
+	/// same as above, but returns a copy, for when the caller is
+	/// going to add dependencies while iterating
 	inline std::vector<ItemPtr> extractDependencies( DependencyType dt ) const;
-	
+
+	/// drops all the dependencies of this item, for when the graph
+	/// has been captured elsewhere (i.e. BuildGraph)
+	inline void releaseDependencies( void );
+
 protected:
-	inline void recurseChain( std::vector<ItemPtr> &chain ) const
+	/// The graph is kept in a topological order as edges are added
+	/// (Pearce & Kelly, "A Dynamic Topological Sort Algorithm for
+	/// Directed Acyclic Graphs") such that every item has a lower
+	/// order than anything which depends on it. This makes the cycle
+	/// check on insert proportional to the region of the graph that
+	/// needs re-ordering rather than a walk of everything downstream.
+	///
+	/// For shared graphs, all graph mutation happens with the mutex
+	/// held. Other graphs (i.e. the build items of one configuration)
+	/// are only touched by one thread at a time, as is everything when
+	/// the thread pool has no workers, so the lock is skipped
+	static std::mutex &graphMutex( void )
 	{
-		for ( auto &dep: myDependencies )
-		{
-			if ( dep.second != DependencyType::CHAIN )
-				continue;
-
-			chain.push_back( dep.first );
-			dep.first->recurseChain( chain );
-		}
+		static std::mutex *theMutex = new std::mutex;
+		return *theMutex;
 	}
+	static std::unique_lock<std::mutex> lockGraph( void )
+	{
+		if ( DependencyTraits<Item>::sharedGraph && ThreadPool::threadCount() > 1 )
+			return std::unique_lock<std::mutex>( graphMutex() );
+		return std::unique_lock<std::mutex>();
+	}
+	inline bool reorderFor( Dependency *other );
+
+	static inline bool sortsBefore( const ItemPtr &a, const ItemPtr &b );
+	inline void addToList( DependencyType dt, const ItemPtr &o );
+	inline void removeFromList( DependencyType dt, const ItemPtr &o );
+	inline void invalidateChain( void );
+	inline void updateChain( void ) const;
 
-	std::map<ItemPtr, DependencyType> myDependencies;
+	struct Edge
+	{
+		DependencyType type;
+		// where we are in the dependency's list of dependents, so
+		// removing the edge is a swap with the last one
+		size_t backIndex;
+	};
+	static inline void unlink( Dependency *other, const Edge &e );
+
+	std::map<ItemPtr, Edge> myDependencies;
+	std::vector<ItemPtr> myDependencyLists[4];
+	std::vector< std::pair<Dependency *, Edge *> > myDependents;
+	size_t myTopoOrder;
+	// creation order, fixed for the life of the item, to tie break
+	// items with the same name and directory
+	size_t mySequence;
+	mutable std::vector<ItemPtr> myChainClosure;
+	mutable bool myChainValid = false;
+	mutable size_t myVisitMark = 0;
 	WeakItemPtr myParent;
+
+private:
+	static size_t nextOrder( void )
+	{
+		static std::atomic<size_t> theOrder( 0 );
+		return ++theOrder;
+	}
+	static size_t nextVisitMark( void )
+	{
+		static std::atomic<size_t> theMark( 0 );
+		return ++theMark;
+	}
 };
 
 
 ////////////////////////////////////////
 
 
+template <typename Item>
+inline
+Dependency<Item>::Dependency( void )
+		: myTopoOrder( nextOrder() ), mySequence( myTopoOrder )
+{
+}
+
+
+////////////////////////////////////////
+
+
+template <typename Item>
+inline
+Dependency<Item>::~Dependency( void )
+{
+	if ( myDependencies.empty() )
+		return;
+
+	auto lk = lockGraph();
+	for ( auto &dep: myDependencies )
+		unlink( dep.first.get(), dep.second );
+}
+
+
+////////////////////////////////////////
+
+
+template <typename Item>
+inline void
+Dependency<Item>::unlink( Dependency *other, const Edge &e )
+{
+	auto &back = other->myDependents;
+	size_t i = e.backIndex;
+	if ( i + 1 != back.size() )
+	{
+		back[i] = back.back();
+		back[i].second->backIndex = i;
+	}
+	back.pop_back();
+}
+
+
+////////////////////////////////////////
+
+
 template <typename Item>
 inline void
 Dependency<Item>::setParent( ItemPtr p )
@@ -109,6 +225,31 @@ Dependency<Item>::getParent( void ) const
 
 
 
+////////////////////////////////////////
+
+
+template <typename Item>
+inline void
+Dependency<Item>::releaseDependencies( void )
+{
+	// swap everything out so any items which are no longer
+	// referenced are destroyed after the lock is released
+	std::map<ItemPtr, Edge> deps;
+	std::vector<ItemPtr> lists[4];
+	std::vector<ItemPtr> chain;
+	auto lk = lockGraph();
+
+	invalidateChain();
+	for ( auto &dep: myDependencies )
+		unlink( dep.first.get(), dep.second );
+	deps.swap( myDependencies );
+	for ( size_t i = 0; i != 4; ++i )
+		lists[i].swap( myDependencyLists[i] );
+	chain.swap( myChainClosure );
+	myChainValid = false;
+}
+
+
 ////////////////////////////////////////
 
 
@@ -119,14 +260,28 @@ Dependency<Item>::addDependency( DependencyType dt, ItemPtr otherObj )
 	if ( ! otherObj )
 		return;
 
-	if ( otherObj->hasDependency( this->shared_from_this() ) )
+	auto lk = lockGraph();
+	auto cur = myDependencies.find( otherObj );
+	if ( cur != myDependencies.end() )
+	{
+		if ( cur->second.type > dt )
+		{
+			removeFromList( cur->second.type, otherObj );
+			cur->second.type = dt;
+			addToList( dt, otherObj );
+		}
+		return;
+	}
+
+	Dependency *other = otherObj.get();
+	if ( other == this || ! reorderFor( other ) )
 		throw std::runtime_error( "Attempt to create a circular dependency between '" + getName() + "' and '" + otherObj->getName() + "'" );
 
-	auto cur = myDependencies.find( otherObj );
-	if ( cur == myDependencies.end() )
-		myDependencies[otherObj] = dt;
-	else if ( cur->second > dt )
-		cur->second = dt;
+	Edge &e = myDependencies[otherObj];
+	e.type = dt;
+	e.backIndex = other->myDependents.size();
+	other->myDependents.emplace_back( this, &e );
+	addToList( dt, otherObj );
 }
 
 
@@ -134,19 +289,24 @@ Dependency<Item>::addDependency( DependencyType dt, ItemPtr otherObj )
 
 
 template <typename Item>
-bool
-Dependency<Item>::hasDependency( const ItemPtr &other ) const
+inline bool
+Dependency<Item>::sortsBefore( const ItemPtr &a, const ItemPtr &b )
 {
-	if ( myDependencies.find( other ) != myDependencies.end() )
-		return true;
+	int c = a->getName().compare( b->getName() );
+	if ( c != 0 )
+		return c < 0;
 
-	for ( auto &dep: myDependencies )
+	const auto &ad = a->getDir();
+	const auto &bd = b->getDir();
+	if ( ad != bd )
 	{
-		if ( dep.first->hasDependency( other ) )
-			return true;
+		if ( ! ad || ! bd )
+			return ! ad;
+		c = ad->fullpath().compare( bd->fullpath() );
+		if ( c != 0 )
+			return c < 0;
 	}
-
-	return false;
+	return a->mySequence < b->mySequence;
 }
 
 
@@ -154,57 +314,235 @@ Dependency<Item>::hasDependency( const ItemPtr &other ) const
 
 
 template <typename Item>
-std::vector<typename Dependency<Item>::ItemPtr>
-Dependency<Item>::extractDependencies( DependencyType dt ) const
+inline void
+Dependency<Item>::addToList( DependencyType dt, const ItemPtr &o )
 {
-	std::vector<ItemPtr> retval;
-	typedef typename std::vector<ItemPtr>::iterator::difference_type difference_type;
+	std::vector<ItemPtr> &l = myDependencyLists[static_cast<size_t>( dt )];
+	l.insert( std::upper_bound( l.begin(), l.end(), o, &Dependency::sortsBefore ), o );
+	if ( dt == DependencyType::CHAIN )
+		invalidateChain();
+}
+
+
+////////////////////////////////////////
 
+
+template <typename Item>
+inline void
+Dependency<Item>::removeFromList( DependencyType dt, const ItemPtr &o )
+{
+	std::vector<ItemPtr> &l = myDependencyLists[static_cast<size_t>( dt )];
+	auto i = std::lower_bound( l.begin(), l.end(), o, &Dependency::sortsBefore );
+	if ( i != l.end() && *i == o )
+		l.erase( i );
 	if ( dt == DependencyType::CHAIN )
-	{
-		recurseChain( retval );
+		invalidateChain();
+}
 
-		if ( ! retval.empty() )
+
+////////////////////////////////////////
+
+
+template <typename Item>
+inline void
+Dependency<Item>::invalidateChain( void )
+{
+	// a cached chain is only valid when the chains it was built
+	// from are, so anything still valid upstream of an invalid
+	// item needs resetting, and we can stop at those that aren't
+	if ( ! myChainValid )
+		return;
+
+	std::vector<Dependency *> stack;
+	stack.push_back( this );
+	myChainValid = false;
+	while ( ! stack.empty() )
+	{
+		Dependency *n = stack.back();
+		stack.pop_back();
+		n->myChainClosure.clear();
+		for ( auto &up: n->myDependents )
 		{
-			// go through in reverse order and remove any duplicates
-			// that follow
-			std::reverse( std::begin( retval ), std::end( retval ) );
+			Dependency *d = up.first;
+			if ( d->myChainValid )
+			{
+				d->myChainValid = false;
+				stack.push_back( d );
+			}
+		}
+	}
+}
 
-			size_t i = 0;
-			while ( i != retval.size() )
+
+////////////////////////////////////////
+
+
+template <typename Item>
+inline void
+Dependency<Item>::updateChain( void ) const
+{
+	if ( myChainValid )
+		return;
+
+	const std::vector<ItemPtr> &direct = myDependencyLists[static_cast<size_t>( DependencyType::CHAIN )];
+	myChainClosure.clear();
+	for ( const ItemPtr &d: direct )
+	{
+		d->updateChain();
+		myChainClosure.push_back( d );
+		myChainClosure.insert( myChainClosure.end(), d->myChainClosure.begin(), d->myChainClosure.end() );
+	}
+	std::sort( myChainClosure.begin(), myChainClosure.end(), &Dependency::sortsBefore );
+	myChainClosure.erase( std::unique( myChainClosure.begin(), myChainClosure.end() ), myChainClosure.end() );
+	myChainValid = true;
+}
+
+
+////////////////////////////////////////
+
+
+template <typename Item>
+inline bool
+Dependency<Item>::reorderFor( Dependency *other )
+{
+	if ( other->myTopoOrder < myTopoOrder )
+		return true;
+
+	// the new edge violates the current order, so find everything
+	// in the affected region (between our order and the other's)
+	// that depends on us, and everything the other item depends on.
+	// If the first set reaches the other item, it's a cycle
+	const size_t lb = myTopoOrder;
+	const size_t ub = other->myTopoOrder;
+	const size_t mark = nextVisitMark();
+	std::vector<Dependency *> fwd, back, stack;
+
+	stack.push_back( this );
+	myVisitMark = mark;
+	while ( ! stack.empty() )
+	{
+		Dependency *n = stack.back();
+		stack.pop_back();
+		fwd.push_back( n );
+		for ( auto &up: n->myDependents )
+		{
+			Dependency *d = up.first;
+			if ( d == other )
+				return false;
+			if ( d->myVisitMark != mark && d->myTopoOrder < ub )
 			{
-				for ( size_t j = i + 1; j < retval.size(); ++j )
-				{
-					if ( retval[i] == retval[j] )
-					{
-						retval.erase( retval.begin() + static_cast<difference_type>( j ) );
-						j = i;
-					}
-				}
-				++i;
+				d->myVisitMark = mark;
+				stack.push_back( d );
 			}
-			std::reverse( std::begin( retval ), std::end( retval ) );
 		}
 	}
-	else
+
+	stack.push_back( other );
+	other->myVisitMark = mark;
+	while ( ! stack.empty() )
 	{
-		for ( auto &dep: myDependencies )
+		Dependency *n = stack.back();
+		stack.pop_back();
+		back.push_back( n );
+		for ( auto &dep: n->myDependencies )
 		{
-			if ( dep.second != dt )
-				continue;
+			Dependency *d = dep.first.get();
+			if ( d->myVisitMark != mark && d->myTopoOrder > lb )
+			{
+				d->myVisitMark = mark;
+				stack.push_back( d );
+			}
+		}
+	}
+
+	// re-use the orders of the affected items, placing the other
+	// item and its dependencies ahead of us and our dependents
+	auto byOrder = []( const Dependency *a, const Dependency *b ) { return a->myTopoOrder < b->myTopoOrder; };
+	std::sort( fwd.begin(), fwd.end(), byOrder );
+	std::sort( back.begin(), back.end(), byOrder );
+
+	std::vector<size_t> orders;
+	orders.reserve( fwd.size() + back.size() );
+	for ( Dependency *n: back )
+		orders.push_back( n->myTopoOrder );
+	for ( Dependency *n: fwd )
+		orders.push_back( n->myTopoOrder );
+	std::sort( orders.begin(), orders.end() );
+
+	size_t o = 0;
+	for ( Dependency *n: back )
+		n->myTopoOrder = orders[o++];
+	for ( Dependency *n: fwd )
+		n->myTopoOrder = orders[o++];
+
+	return true;
+}
 
-			retval.push_back( dep.first );
+
+////////////////////////////////////////
+
+
+template <typename Item>
+bool
+Dependency<Item>::hasDependency( const ItemPtr &other ) const
+{
+	if ( ! other )
+		return false;
+
+	auto lk = lockGraph();
+	if ( other->myTopoOrder >= myTopoOrder )
+		return false;
+
+	// anything with an order lower than the other item can not
+	// depend on it, so the walk is bounded by the order
+	const Dependency *target = other.get();
+	const size_t mark = nextVisitMark();
+	std::vector<const Dependency *> stack;
+	stack.push_back( this );
+	myVisitMark = mark;
+	while ( ! stack.empty() )
+	{
+		const Dependency *n = stack.back();
+		stack.pop_back();
+		for ( auto &dep: n->myDependencies )
+		{
+			const Dependency *d = dep.first.get();
+			if ( d == target )
+				return true;
+			if ( d->myVisitMark != mark && d->myTopoOrder > target->myTopoOrder )
+			{
+				d->myVisitMark = mark;
+				stack.push_back( d );
+			}
 		}
 	}
 
-	std::sort( retval.begin(), retval.end(),
-			   []( const ItemPtr &a, const ItemPtr &b )
-			   {
-				   return (a->getName() < b->getName() ||
-						   (a->getName() == b->getName() &&
-							a->getDir()->fullpath() < b->getDir()->fullpath()));
-			   }
-			   );
+	return false;
+}
+
+
+////////////////////////////////////////
+
+
+template <typename Item>
+inline const std::vector<typename Dependency<Item>::ItemPtr> &
+Dependency<Item>::dependencies( DependencyType dt ) const
+{
+	if ( dt != DependencyType::CHAIN )
+		return myDependencyLists[static_cast<size_t>( dt )];
+
+	auto lk = lockGraph();
+	updateChain();
+	return myChainClosure;
+}
+
+
+////////////////////////////////////////
+
 
-	return std::move( retval );
+template <typename Item>
+inline std::vector<typename Dependency<Item>::ItemPtr>
+Dependency<Item>::extractDependencies( DependencyType dt ) const
+{
+	return dependencies( dt );
 }
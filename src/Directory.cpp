@@ -38,13 +38,16 @@
 #include <list>
 #include <iterator>
 #include <stack>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
 
 
 namespace 
 {
 
 static std::string theCWD;
-static std::vector<std::string> theCWDPath;
 
 static void initCWD( void )
 {
@@ -58,11 +61,14 @@ static void initCWD( void )
 	ON_EXIT{ free( cwd ); };
 
 	theCWD = cwd;
-	theCWDPath = String::split( theCWD, File::pathSeparator() );
 }
 
-std::shared_ptr<Directory> theLastDir;
-static std::stack< std::shared_ptr<Directory> > theLiveDirs;
+// the directory stack follows the evaluation, which may happen on
+// several threads at once (see Lua::Engine::ThreadEngine)
+static thread_local std::shared_ptr<Directory> theLastDir;
+static thread_local std::stack< std::shared_ptr<Directory> > theLiveDirs;
+
+static std::mutex theNodeMutex;
 
 } // empty namespace
 
@@ -70,75 +76,121 @@ static std::stack< std::shared_ptr<Directory> > theLiveDirs;
 ////////////////////////////////////////
 
 
-Directory::Directory( void )
+struct Directory::Node
 {
-	initCWD();
+	Node( const Node *p, const Symbol &c, std::string &&fp )
+			: parent( p ), name( c ), path( std::move( fp ) )
+	{}
 
-	myFullDirs = theCWDPath;
-	myCurFullPath = theCWD;
-}
+	const Node *parent;
+	Symbol name;
+	std::string path;
+	mutable std::unordered_map<Symbol, const Node *> children;
+};
 
 
 ////////////////////////////////////////
 
 
-Directory::Directory( const std::string &root )
-		: myFullDirs( String::split( root, File::pathSeparator() ) ), myCurFullPath( root )
+const Directory::Node *
+Directory::absRoot( void )
 {
+	static const Node *theRoot = new Node( nullptr, Symbol(), std::string() );
+	return theRoot;
 }
 
 
 ////////////////////////////////////////
 
 
-Directory::Directory( const Directory &d )
-		: mySubDirs( d.mySubDirs ),
-		  myFullDirs( d.myFullDirs ),
-		  myCurFullPath( d.myCurFullPath )
+const Directory::Node *
+Directory::relRoot( void )
 {
+	static const Node *theRoot = new Node( nullptr, Symbol(), std::string() );
+	return theRoot;
 }
 
 
 ////////////////////////////////////////
 
 
-Directory::Directory( Directory &&d )
-		: mySubDirs( std::move( d.mySubDirs ) ),
-		  myFullDirs( std::move( d.myFullDirs ) ),
-		  myCurFullPath( std::move( d.myCurFullPath ) )
+const Directory::Node *
+Directory::child( const Node *n, const Symbol &c )
 {
+	std::lock_guard<std::mutex> lk( theNodeMutex );
+	auto i = n->children.find( c );
+	if ( i != n->children.end() )
+		return i->second;
+
+	std::string fp;
+	if ( n != relRoot() )
+	{
+		fp.reserve( n->path.size() + 1 + c.str().size() );
+		fp = n->path;
+		fp.push_back( File::pathSeparator() );
+	}
+	fp.append( c.str() );
+	const Node *ret = new Node( n, c, std::move( fp ) );
+	n->children[c] = ret;
+	return ret;
 }
 
 
 ////////////////////////////////////////
 
 
-Directory &
-Directory::operator=( const Directory &d )
+const Directory::Node *
+Directory::append( const Node *n, const std::string &path )
 {
-	if ( this != &d )
+	std::string::size_type last = path.find_first_not_of( File::pathSeparator(), 0 );
+	while ( last != std::string::npos )
 	{
-		mySubDirs = d.mySubDirs;
-		myFullDirs = d.myFullDirs;
-		myCurFullPath = d.myCurFullPath;
+		std::string::size_type cur = path.find_first_of( File::pathSeparator(), last );
+		n = child( n, Symbol( path.substr( last, cur - last ) ) );
+		last = path.find_first_not_of( File::pathSeparator(), cur );
 	}
-	return *this;
+	return n;
 }
 
 
 ////////////////////////////////////////
 
 
-Directory &
-Directory::operator=( Directory &&d )
+void
+Directory::components( std::vector<Symbol> &l, const Node *n )
 {
-	if ( this != &d )
-	{
-		mySubDirs = std::move( d.mySubDirs );
-		myFullDirs = std::move( d.myFullDirs );
-		myCurFullPath = std::move( d.myCurFullPath );
-	}
-	return *this;
+	size_t start = l.size();
+	for ( ; n->parent; n = n->parent )
+		l.push_back( n->name );
+	std::reverse( l.begin() + static_cast<std::vector<Symbol>::difference_type>( start ), l.end() );
+}
+
+
+////////////////////////////////////////
+
+
+Directory::Directory( void )
+{
+	initCWD();
+
+	static const Node *theCWDNode = append( absRoot(), theCWD );
+	myFullDirs = theCWDNode;
+	mySubDirs = relRoot();
+	myPath = theCWDNode;
+	if ( theCWD != myPath->path )
+		myRootPath = theCWD;
+}
+
+
+////////////////////////////////////////
+
+
+Directory::Directory( const std::string &root )
+		: myFullDirs( append( absRoot(), root ) ), mySubDirs( relRoot() )
+{
+	myPath = myFullDirs;
+	if ( root != myPath->path )
+		myRootPath = root;
 }
 
 
@@ -148,10 +200,10 @@ Directory::operator=( Directory &&d )
 void
 Directory::extractDirFromFile( const std::string &fn )
 {
-	myFullDirs = String::split( fn, File::pathSeparator() );
-	if ( ! myFullDirs.empty() )
-		myFullDirs.pop_back();
-	mySubDirs.clear();
+	myFullDirs = append( absRoot(), fn );
+	if ( myFullDirs != absRoot() )
+		myFullDirs = myFullDirs->parent;
+	mySubDirs = relRoot();
 	updateFullPath();
 }
 
@@ -191,20 +243,7 @@ Directory::reroot( const std::shared_ptr<Directory> &newroot ) const
 void
 Directory::rematch( const Directory &d )
 {
-	bool needChange = true;
-	if ( d.mySubDirs.size() == mySubDirs.size() )
-	{
-		needChange = false;
-		for ( size_t i = 0; i != mySubDirs.size(); ++i )
-		{
-			if ( mySubDirs[i] != d.mySubDirs[i] )
-			{
-				needChange = true;
-				break;
-			}
-		}
-	}
-	if ( needChange )
+	if ( mySubDirs != d.mySubDirs )
 	{
 		mySubDirs = d.mySubDirs;
 		updateFullPath();
@@ -218,13 +257,11 @@ Directory::rematch( const Directory &d )
 void
 Directory::cd( const std::string &name )
 {
-	std::vector<std::string> dirs = String::split( name, File::pathSeparator() );
-	if ( dirs.empty() )
+	const Node *n = append( mySubDirs, name );
+	if ( n == mySubDirs )
 		return;
 
-	for ( auto &d: dirs )
-		mySubDirs.emplace_back( std::move( d ) );
-
+	mySubDirs = n;
 	updateFullPath();
 }
 
@@ -235,13 +272,13 @@ Directory::cd( const std::string &name )
 void
 Directory::cdUp( void )
 {
-	if ( ! mySubDirs.empty() )
-		mySubDirs.pop_back();
+	if ( mySubDirs != relRoot() )
+		mySubDirs = mySubDirs->parent;
 	else
 	{
-		if ( myFullDirs.empty() )
+		if ( myFullDirs == absRoot() )
 			throw std::runtime_error( "Attempt to change directories above root" );
-		myFullDirs.pop_back();
+		myFullDirs = myFullDirs->parent;
 	}
 	
 	updateFullPath();
@@ -254,11 +291,11 @@ Directory::cdUp( void )
 const std::string &
 Directory::cur( void ) const
 {
-	if ( ! mySubDirs.empty() )
-		return mySubDirs.back();
+	if ( mySubDirs != relRoot() )
+		return mySubDirs->name.str();
 
-	if ( ! myFullDirs.empty() )
-		return myFullDirs.back();
+	if ( myFullDirs != absRoot() )
+		return myFullDirs->name.str();
 
 	return String::empty();
 }
@@ -273,14 +310,13 @@ Directory::mkpath( void ) const
 #ifdef WIN32
 	throw std::logic_error( "NYI: Need to handle drive letters" );
 #endif
-	std::string tmpPath;
-	std::vector<std::string> alldirs;
-	combinePath( alldirs );
-	for ( const auto &curDir: alldirs )
-	{
-		tmpPath.push_back( File::pathSeparator() );
-		tmpPath.append( curDir );
+	std::vector<const Node *> alldirs;
+	for ( const Node *n = myPath; n->parent; n = n->parent )
+		alldirs.push_back( n );
 
+	for ( auto i = alldirs.rbegin(); i != alldirs.rend(); ++i )
+	{
+		const std::string &tmpPath = (*i)->path;
 		if ( mkdir( tmpPath.c_str(), 0777 ) != 0 )
 		{
 			if ( errno == EEXIST )
@@ -289,6 +325,7 @@ Directory::mkpath( void ) const
 			throw std::system_error( errno, std::system_category(),
 				"Unable to create directory '" + tmpPath + "'" );
 		}
+		File::invalidateStatCache( tmpPath );
 	}
 }
 
@@ -299,7 +336,9 @@ Directory::mkpath( void ) const
 const std::string &
 Directory::fullpath( void ) const
 {
-	return myCurFullPath;
+	if ( ! myRootPath.empty() )
+		return myRootPath;
+	return myPath->path;
 }
 
 
@@ -309,15 +348,7 @@ Directory::fullpath( void ) const
 std::string
 Directory::relpath( void ) const
 {
-	std::string ret;
-
-	for ( const std::string &p: mySubDirs )
-	{
-		if ( ! ret.empty() )
-			ret.push_back( File::pathSeparator() );
-		ret.append( p );
-	}
-	return ret;
+	return mySubDirs->path;
 }
 
 
@@ -327,9 +358,11 @@ Directory::relpath( void ) const
 void
 Directory::promoteFull( void )
 {
-	for ( auto &d: mySubDirs )
-		myFullDirs.emplace_back( std::move( d ) );
-	mySubDirs.clear();
+	std::vector<Symbol> subs;
+	components( subs, mySubDirs );
+	for ( const Symbol &c: subs )
+		myFullDirs = child( myFullDirs, c );
+	mySubDirs = relRoot();
 }
 
 
@@ -339,18 +372,33 @@ Directory::promoteFull( void )
 void
 Directory::updateFullPath( void )
 {
-	std::vector<std::string> pathElements;
-	combinePath( pathElements );
-
 #ifdef WIN32
 	throw std::logic_error( "NYI: Need to handle drive letters" );
 #endif
-	myCurFullPath.clear();
-	for ( const std::string &i: pathElements )
+	static const Symbol theDot( "." );
+	static const Symbol theDotDot( ".." );
+
+	std::vector<Symbol> subs;
+	components( subs, mySubDirs );
+
+	const Node *n = myFullDirs;
+	for ( const Symbol &p: subs )
 	{
-		myCurFullPath.push_back( File::pathSeparator() );
-		myCurFullPath.append( i );
+		if ( p == theDot )
+			continue;
+
+		if ( p == theDotDot )
+		{
+			if ( n == absRoot() )
+				throw std::runtime_error( "Invalid attempt to create relative path above root" );
+
+			n = n->parent;
+		}
+		else
+			n = child( n, p );
 	}
+	myPath = n;
+	myRootPath.clear();
 }
 
 
@@ -378,11 +426,8 @@ Directory::exists( std::string &concatpath, const char *fn ) const
 {
 	concatpath = makefilename( fn );
 
-	struct stat sb;
-	if ( stat( concatpath.c_str(), &sb ) == 0 )
-		return true;
-
-	return false;
+	bool isDir = false;
+	return File::cachedStat( concatpath, isDir );
 }
 
 
@@ -394,11 +439,8 @@ Directory::exists( std::string &concatpath, const std::string &fn ) const
 {
 	concatpath = makefilename( fn );
 
-	struct stat sb;
-	if ( stat( concatpath.c_str(), &sb ) == 0 )
-		return true;
-
-	return false;
+	bool isDir = false;
+	return File::cachedStat( concatpath, isDir );
 }
 
 
@@ -408,9 +450,13 @@ Directory::exists( std::string &concatpath, const std::string &fn ) const
 std::string
 Directory::makefilename( const char *fn ) const
 {
-	std::string concatpath = fullpath();
+	const std::string &fp = fullpath();
+	size_t fnl = strlen( fn );
+	std::string concatpath;
+	concatpath.reserve( fp.size() + 1 + fnl );
+	concatpath = fp;
 	concatpath.push_back( File::pathSeparator() );
-	concatpath.append( fn );
+	concatpath.append( fn, fnl );
 	return concatpath;
 }
 
@@ -421,7 +467,10 @@ Directory::makefilename( const char *fn ) const
 std::string
 Directory::makefilename( const std::string &fn ) const
 {
-	std::string concatpath = fullpath();
+	const std::string &fp = fullpath();
+	std::string concatpath;
+	concatpath.reserve( fp.size() + 1 + fn.size() );
+	concatpath = fp;
 	concatpath.push_back( File::pathSeparator() );
 	concatpath.append( fn );
 	return concatpath;
@@ -448,19 +497,13 @@ std::string
 Directory::relativeTo( const Directory &o,
 					   const std::string &fn ) const
 {
-	std::vector<const std::string *> mynonCommonSubdirs;
-	mynonCommonSubdirs.reserve( myFullDirs.size() + mySubDirs.size() );
-	for ( const std::string &i: myFullDirs )
-		mynonCommonSubdirs.push_back( &i );
-	for ( const std::string &i: mySubDirs )
-		mynonCommonSubdirs.push_back( &i );
+	std::vector<Symbol> mynonCommonSubdirs;
+	components( mynonCommonSubdirs, myFullDirs );
+	components( mynonCommonSubdirs, mySubDirs );
 
-	std::vector<const std::string *> relPath;
-	relPath.reserve( o.myFullDirs.size() + o.mySubDirs.size() );
-	for ( const std::string &i: o.myFullDirs )
-		relPath.push_back( &i );
-	for ( const std::string &i: o.mySubDirs )
-		relPath.push_back( &i );
+	std::vector<Symbol> relPath;
+	components( relPath, o.myFullDirs );
+	components( relPath, o.mySubDirs );
 
 	size_t subdirI = 0;
 	size_t relI = 0;
@@ -468,7 +511,7 @@ Directory::relativeTo( const Directory &o,
 	{
 		if ( subdirI == mynonCommonSubdirs.size() || relI == relPath.size() )
 			break;
-		if ( *(mynonCommonSubdirs[subdirI]) != *(relPath[relI]) )
+		if ( mynonCommonSubdirs[subdirI] != relPath[relI] )
 			break;
 
 		++subdirI;
@@ -490,7 +533,7 @@ Directory::relativeTo( const Directory &o,
 	{
 		if ( notfirst )
 			ret.push_back( File::pathSeparator() );
-		ret.append( *(mynonCommonSubdirs[subdirI]) );
+		ret.append( mynonCommonSubdirs[subdirI].str() );
 		++subdirI;
 		notfirst = true;
 	}
@@ -554,6 +597,7 @@ Directory::updateIfDifferent( const std::string &name, const std::vector<std::st
 		std::ofstream outf( fn );
 		for ( const std::string &l: lines )
 			outf << l << '\n';
+		File::invalidateStatCache( fn );
 	}
 }
 
@@ -629,30 +673,4 @@ Directory::last( void )
 ////////////////////////////////////////
 
 
-void
-Directory::combinePath( std::vector<std::string> &elements ) const
-{
-	elements = myFullDirs;
-	for ( const std::string &p: mySubDirs )
-	{
-		if ( p == "." )
-			continue;
-
-		if ( p == ".." )
-		{
-			if ( elements.empty() )
-				throw std::runtime_error( "Invalid attempt to create relative path above root" );
-
-			elements.pop_back();
-		}
-		else
-			elements.push_back( p );
-	}
-
-}
-
-
-////////////////////////////////////////
-
-
 
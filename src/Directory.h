@@ -26,6 +26,7 @@
 #include <vector>
 #include <memory>
 #include "FileUtil.h"
+#include "Symbol.h"
 
 
 ////////////////////////////////////////
@@ -36,10 +37,10 @@ class Directory
 public:
 	Directory( void );
 	Directory( const std::string &root );
-	Directory( const Directory &d );
-	Directory( Directory &&d );
-	Directory &operator=( const Directory &d );
-	Directory &operator=( Directory &&d );
+	Directory( const Directory &d ) = default;
+	Directory( Directory &&d ) = default;
+	Directory &operator=( const Directory &d ) = default;
+	Directory &operator=( Directory &&d ) = default;
 
 	void extractDirFromFile( const std::string &fn );
 
@@ -90,13 +91,28 @@ public:
 	static const std::shared_ptr<Directory> &last( void );
 
 private:
-	void combinePath( std::vector<std::string> &fullpath ) const;
+	/// paths are nodes in a shared trie which is never freed, each
+	/// with a parent, the path component, and the complete path
+	/// string, so copying a directory is copying a few pointers and
+	/// cd only has to find (or add) the child nodes
+	struct Node;
+	static const Node *absRoot( void );
+	static const Node *relRoot( void );
+	static const Node *child( const Node *n, const Symbol &c );
+	static const Node *append( const Node *n, const std::string &path );
+	static void components( std::vector<Symbol> &l, const Node *n );
+
 	bool checkRootPath( void ) const;
 	void updateFullPath( void );
 
-	std::vector<std::string> mySubDirs;
-	std::vector<std::string> myFullDirs;
-	std::string myCurFullPath;
+	// the (absolute) root, as given, the path components cd-ed to
+	// (relative, as given), and the two combined with any . and ..
+	// in the sub directories resolved
+	const Node *myFullDirs;
+	const Node *mySubDirs;
+	const Node *myPath;
+	// a root path given as a string is used verbatim until changed
+	std::string myRootPath;
 };
 
 
@@ -27,6 +27,10 @@
 #include "OSUtil.h"
 #include "StrUtil.h"
 #include "Scope.h"
+#include "Debug.h"
+#include "CacheData.h"
+#include "GlobPattern.h"
+#include "ThreadPool.h"
 
 #include <unistd.h>
 #include <errno.h>
@@ -41,7 +45,18 @@
 #include <fcntl.h>
 #include <string.h>
 #include <iostream>
-#include <regex>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <set>
+#include <tuple>
+#include <algorithm>
+#include <iterator>
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
 
 
 ////////////////////////////////////////
@@ -61,6 +76,435 @@ static void initPath( void )
 	thePath = String::split( OS::getenv( "PATH" ), OS::pathSeparator() );
 }
 static std::string theArgv0;
+static std::string theCacheDir;
+
+struct DirListing
+{
+	// opendir failed such that nothing below can exist
+	bool missing = false;
+	// opendir failed some other way (i.e. permissions), have to stat
+	bool unreadable = false;
+	// name and d_type, sorted by name
+	std::vector< std::pair<std::string, unsigned char> > entries;
+};
+
+static std::mutex theStatMutex;
+static std::unordered_map< std::string, std::shared_ptr<const DirListing> > theListings;
+// results of the stat calls we still had to make, -1 missing, 0
+// file, 1 directory
+static std::unordered_map<std::string, int> theStatResults;
+static std::atomic<size_t> theStatLookups( 0 );
+static std::atomic<size_t> theDirReads( 0 );
+static std::atomic<size_t> theStatCalls( 0 );
+
+#ifdef __linux__
+// layout the kernel fills in for getdents64
+struct LinuxDirent64
+{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+#endif
+
+static std::shared_ptr<const DirListing>
+readListing( const std::string &dir )
+{
+	std::shared_ptr<DirListing> ret = std::make_shared<DirListing>();
+	++theDirReads;
+#ifdef __linux__
+	// read the entries in large batches straight from the kernel,
+	// which already gives us the type of (nearly) every entry,
+	// rather than through the DIR stream one entry at a time
+	int fd = ::open( dir.empty() ? "/" : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+	if ( fd < 0 )
+	{
+		if ( errno == ENOENT || errno == ENOTDIR )
+			ret->missing = true;
+		else
+			ret->unreadable = true;
+		return ret;
+	}
+	ON_EXIT{ ::close( fd ); };
+
+	alignas(8) char buf[65536];
+	while ( true )
+	{
+		long n = ::syscall( SYS_getdents64, fd, buf, sizeof(buf) );
+		if ( n < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			ret->entries.clear();
+			ret->unreadable = true;
+			break;
+		}
+		if ( n == 0 )
+			break;
+
+		for ( long off = 0; off < n; )
+		{
+			const LinuxDirent64 *cur = reinterpret_cast<const LinuxDirent64 *>( buf + off );
+			ret->entries.emplace_back( cur->d_name, cur->d_type );
+			off += cur->d_reclen;
+		}
+	}
+#else
+	DIR *d = ::opendir( dir.empty() ? "/" : dir.c_str() );
+	if ( ! d )
+	{
+		if ( errno == ENOENT || errno == ENOTDIR )
+			ret->missing = true;
+		else
+			ret->unreadable = true;
+		return ret;
+	}
+	ON_EXIT{ ::closedir( d ); };
+
+	while ( true )
+	{
+		errno = 0;
+		struct dirent *cur = ::readdir( d );
+		if ( ! cur )
+		{
+			if ( errno != 0 )
+			{
+				ret->entries.clear();
+				ret->unreadable = true;
+			}
+			break;
+		}
+#ifdef _DIRENT_HAVE_D_TYPE
+		ret->entries.emplace_back( cur->d_name, cur->d_type );
+#else
+		ret->entries.emplace_back( cur->d_name, DT_UNKNOWN );
+#endif
+	}
+#endif
+	std::sort( ret->entries.begin(), ret->entries.end() );
+	return ret;
+}
+
+static int
+statPath( const std::string &path )
+{
+	{
+		std::lock_guard<std::mutex> lk( theStatMutex );
+		auto i = theStatResults.find( path );
+		if ( i != theStatResults.end() )
+			return i->second;
+	}
+
+	++theStatCalls;
+	int r = -1;
+	struct stat sb;
+	if ( ::stat( path.c_str(), &sb ) == 0 )
+		r = S_ISDIR( sb.st_mode ) ? 1 : 0;
+
+	std::lock_guard<std::mutex> lk( theStatMutex );
+	theStatResults[path] = r;
+	return r;
+}
+
+// executable lookups only depend on the search path, so are kept
+// per search path for the whole run, and in the cache directory
+// between runs, checked against the modification times of the
+// path's directories (which change when a program is added or
+// removed)
+struct ExeCache
+{
+	std::vector<std::pair<int64_t, int64_t>> dirTimes;
+	// program name to where it was found, empty when it wasn't
+	std::map<std::string, std::string> found;
+};
+
+static const char theExeCacheMagic[8] = { 'C', 'T', 'O', 'R', 'E', 'X', 'E', '1' };
+static std::mutex theExeMutex;
+static std::map<std::string, ExeCache> theExeCaches;
+static bool theExeCacheLoaded = false;
+static bool theExeCacheDirty = false;
+// the search directories and programs lookups this run depended on
+static std::set<std::string> theExeInputs;
+
+static std::string
+exeCacheFile( void )
+{
+	return theCacheDir + File::pathSeparator() + "executables";
+}
+
+static std::string
+pathKey( const std::vector<std::string> &path )
+{
+	std::string ret;
+	for ( auto &p: path )
+	{
+		if ( ! ret.empty() )
+			ret.push_back( '\n' );
+		ret.append( p );
+	}
+	return ret;
+}
+
+static std::vector<std::pair<int64_t, int64_t>>
+dirTimes( const std::vector<std::string> &path )
+{
+	std::vector<std::pair<int64_t, int64_t>> ret;
+	for ( auto &p: path )
+	{
+		int64_t sec = -1, nsec = -1;
+		File::modTime( p, sec, nsec );
+		ret.emplace_back( sec, nsec );
+	}
+	return ret;
+}
+
+// merges in what a previous run found, for any search path whose
+// directories are unchanged. Called with theExeMutex held
+static void
+loadExeCaches( void )
+{
+	theExeCacheLoaded = true;
+	std::string data;
+	if ( ! File::readCacheFile( exeCacheFile(), data ) ||
+		 data.compare( 0, sizeof(theExeCacheMagic), theExeCacheMagic, sizeof(theExeCacheMagic) ) != 0 )
+		return;
+
+	CacheData::Reader rdr( data, sizeof(theExeCacheMagic) );
+	while ( ! rdr.atEnd() )
+	{
+		std::vector<std::string> path;
+		ExeCache c;
+		int64_t n;
+		if ( ! rdr.get( path ) || ! rdr.get( n ) || n != static_cast<int64_t>( path.size() ) )
+			return;
+		for ( int64_t i = 0; i < n; ++i )
+		{
+			int64_t sec, nsec;
+			if ( ! rdr.get( sec ) || ! rdr.get( nsec ) )
+				return;
+			c.dirTimes.emplace_back( sec, nsec );
+		}
+		if ( ! rdr.get( c.found ) )
+			return;
+
+		if ( c.dirTimes != dirTimes( path ) )
+			continue;
+
+		std::string key = pathKey( path );
+		auto cur = theExeCaches.find( key );
+		if ( cur == theExeCaches.end() )
+			theExeCaches.emplace( key, std::move( c ) );
+		else if ( cur->second.dirTimes == c.dirTimes )
+			cur->second.found.insert( c.found.begin(), c.found.end() );
+	}
+}
+
+// called with theExeMutex held
+static void
+saveExeCaches( void )
+{
+	std::string out( theExeCacheMagic, sizeof(theExeCacheMagic) );
+	for ( auto &c: theExeCaches )
+	{
+		CacheData::put( out, String::split( c.first, '\n' ) );
+		CacheData::put( out, static_cast<int64_t>( c.second.dirTimes.size() ) );
+		for ( auto &t: c.second.dirTimes )
+		{
+			CacheData::put( out, t.first );
+			CacheData::put( out, t.second );
+		}
+		CacheData::put( out, c.second.found );
+	}
+	File::writeCacheFile( exeCacheFile(), out );
+}
+
+// called with theExeMutex held
+static ExeCache &
+exeCacheFor( const std::vector<std::string> &path )
+{
+	if ( ! theExeCacheLoaded && ! theCacheDir.empty() )
+		loadExeCaches();
+
+	std::string key = pathKey( path );
+	auto i = theExeCaches.find( key );
+	if ( i == theExeCaches.end() )
+	{
+		i = theExeCaches.emplace( key, ExeCache() ).first;
+		i->second.dirTimes = dirTimes( path );
+	}
+	return i->second;
+}
+
+static std::shared_ptr<const DirListing>
+getListing( const std::string &dir )
+{
+	{
+		std::lock_guard<std::mutex> lk( theStatMutex );
+		auto i = theListings.find( dir );
+		if ( i != theListings.end() )
+			return i->second;
+	}
+
+	std::shared_ptr<const DirListing> l = readListing( dir );
+	std::lock_guard<std::mutex> lk( theStatMutex );
+	return theListings.emplace( dir, l ).first->second;
+}
+
+// answers whether entry exists in dir (already read in to l),
+// returning -1 for missing, 0 for a file and 1 for a directory
+static int
+lookupEntry( const DirListing &l, const std::string &dir, const std::string &entry )
+{
+	++theStatLookups;
+	if ( l.missing )
+		return -1;
+
+	if ( ! l.unreadable )
+	{
+		auto e = std::lower_bound(
+			l.entries.begin(), l.entries.end(), entry,
+			[]( const std::pair<std::string, unsigned char> &a, const std::string &b ) { return a.first < b; } );
+		if ( e == l.entries.end() || e->first != entry )
+			return -1;
+		if ( e->second == DT_DIR )
+			return 1;
+		if ( e->second != DT_LNK && e->second != DT_UNKNOWN )
+			return 0;
+	}
+
+	// symlinks need following (and may dangle), and some file
+	// systems don't fill in the type
+	std::string path;
+	path.reserve( dir.size() + 1 + entry.size() );
+	path = dir;
+	path.push_back( File::pathSeparator() );
+	path.append( entry );
+	return statPath( path );
+}
+
+// whether a directory entry is a directory, without following
+// symlinks, so recursing for ** can't loop
+static bool
+isRealDirectory( unsigned char type, const std::string &dir, const std::string &entry )
+{
+	if ( type == DT_DIR )
+		return true;
+	if ( type != DT_UNKNOWN )
+		return false;
+
+	struct stat sb;
+	std::string path = dir;
+	path.push_back( File::pathSeparator() );
+	path.append( entry );
+	return ::lstat( path.c_str(), &sb ) == 0 && S_ISDIR( sb.st_mode );
+}
+
+static inline bool
+isDotOrDotDot( const std::string &n )
+{
+	return n[0] == '.' && ( n.size() == 1 || ( n.size() == 2 && n[1] == '.' ) );
+}
+
+static std::string
+joinPath( const std::string &a, const std::string &b )
+{
+	if ( a.empty() )
+		return b;
+	if ( b.empty() )
+		return a;
+	std::string ret;
+	ret.reserve( a.size() + 1 + b.size() );
+	ret = a;
+	ret.push_back( File::pathSeparator() );
+	ret.append( b );
+	return ret;
+}
+
+// a directory (relative to the glob root) still to be matched against
+// the remaining components of one of the pattern alternatives
+struct GlobNode
+{
+	std::string rel;
+	size_t alt;
+	size_t seg;
+};
+
+struct GlobStep
+{
+	std::vector<GlobNode> next;
+	std::vector<std::string> found;
+	std::vector<std::string> searched;
+};
+
+static void
+globNode( const std::string &root,
+		  const std::vector<GlobPattern> &segs,
+		  const GlobNode &n,
+		  GlobStep &out )
+{
+	const GlobPattern &g = segs[n.seg];
+	const bool last = ( n.seg + 1 ) == segs.size();
+	const std::string dir = joinPath( root, n.rel );
+
+	std::shared_ptr<const DirListing> l = getListing( dir );
+	if ( g.isLiteral() )
+	{
+		int r = lookupEntry( *l, dir, g.pattern() );
+		if ( last )
+		{
+			out.searched.push_back( dir );
+			if ( r >= 0 )
+				out.found.push_back( joinPath( n.rel, g.pattern() ) );
+		}
+		else if ( r == 1 )
+			out.next.push_back( { joinPath( n.rel, g.pattern() ), n.alt, n.seg + 1 } );
+		return;
+	}
+
+	out.searched.push_back( dir );
+	if ( l->missing || l->unreadable )
+	{
+		if ( n.rel.empty() )
+			WARNING( "path '" << dir << "' does not exist globbing files" );
+		return;
+	}
+
+	if ( g.isRecursive() )
+	{
+		// ** matching no directories at all
+		if ( ! last )
+			globNode( root, segs, { n.rel, n.alt, n.seg + 1 }, out );
+
+		// or descend, skipping hidden directories (.git and the
+		// like). A trailing ** matches all the files below, but not
+		// the directories themselves
+		for ( const auto &e: l->entries )
+		{
+			if ( isDotOrDotDot( e.first ) )
+				continue;
+			if ( isRealDirectory( e.second, dir, e.first ) )
+			{
+				if ( e.first[0] != '.' )
+					out.next.push_back( { joinPath( n.rel, e.first ), n.alt, n.seg } );
+			}
+			else if ( last && lookupEntry( *l, dir, e.first ) == 0 )
+				out.found.push_back( joinPath( n.rel, e.first ) );
+		}
+		return;
+	}
+
+	for ( const auto &e: l->entries )
+	{
+		if ( isDotOrDotDot( e.first ) || ! g.matches( e.first ) )
+			continue;
+		if ( last )
+			out.found.push_back( joinPath( n.rel, e.first ) );
+		else if ( lookupEntry( *l, dir, e.first ) == 1 )
+			out.next.push_back( { joinPath( n.rel, e.first ), n.alt, n.seg + 1 } );
+	}
+}
 
 } // empty namespace
 
@@ -114,20 +558,11 @@ exists( const char *fn )
 	if ( ! fn || fn[0] == '\0' )
 		return false;
 
-	bool e = false;
+	bool isDir = false;
 	if ( isAbsolute( fn ) )
-	{
-		struct stat sb;
-		if ( stat( fn, &sb ) == 0 )
-			e = true;
-	}
-	else
-	{
-		std::string tmp;
-		e = Directory::current()->exists( tmp, fn );
-	}
+		return cachedStat( fn, isDir );
 
-	return e;
+	return cachedStat( Directory::current()->makefilename( fn ), isDir );
 }
 
 
@@ -140,28 +575,67 @@ isDirectory( const char *fn )
 	if ( ! fn || fn[0] == '\0' )
 		return false;
 
-	bool e = false;
+	bool isDir = false;
 	if ( isAbsolute( fn ) )
+		return cachedStat( fn, isDir ) && isDir;
+
+	return cachedStat( Directory::current()->makefilename( fn ), isDir ) && isDir;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+cachedStat( const std::string &path, bool &isDir )
+{
+	isDir = false;
+
+	std::string::size_type sep = path.find_last_of( pathSeparator() );
+	if ( sep == std::string::npos || sep + 1 == path.size() )
 	{
-		struct stat sb;
-		if ( stat( fn, &sb ) == 0 )
-		{
-			if ( S_ISDIR( sb.st_mode ) )
-				e = true;
-		}
-	}
-	else
-	{
-		std::string tmp = Directory::current()->makefilename( fn );
-		struct stat sb;
-		if ( stat( tmp.c_str(), &sb ) == 0 )
-		{
-			if ( S_ISDIR( sb.st_mode ) )
-				e = true;
-		}
+		++theStatLookups;
+		int r = statPath( path );
+		isDir = ( r == 1 );
+		return r >= 0;
 	}
 
-	return e;
+	std::string dir = path.substr( 0, sep );
+	std::shared_ptr<const DirListing> l = getListing( dir );
+	int r = lookupEntry( *l, dir, path.substr( sep + 1 ) );
+	isDir = ( r == 1 );
+	return r >= 0;
+}
+
+
+////////////////////////////////////////
+
+
+void
+invalidateStatCache( const std::string &path )
+{
+	std::lock_guard<std::mutex> lk( theStatMutex );
+	theStatResults.erase( path );
+	theListings.erase( path );
+
+	std::string::size_type sep = path.find_last_of( pathSeparator() );
+	if ( sep != std::string::npos )
+		theListings.erase( path.substr( 0, sep ) );
+}
+
+
+////////////////////////////////////////
+
+
+void
+reportStatCache( void )
+{
+	size_t lookups = theStatLookups;
+	size_t calls = theDirReads + theStatCalls;
+	VERBOSE( "File existence checks: " << lookups << " answered with "
+			 << theDirReads << " directory reads and " << theStatCalls
+			 << " stat calls (" << ( lookups > calls ? lookups - calls : 0 )
+			 << " system calls saved)" );
 }
 
 
@@ -374,16 +848,26 @@ find( std::string &filepath, const std::string &name, const std::vector<std::str
 		return true;
 	}
 
+	// a name with directories in it (i.e. require "sub/helper") is
+	// looked up in the listing of the directory it ends up in
+	std::string::size_type sep = name.find_last_of( pathSeparator() );
+	std::string leaf = ( sep == std::string::npos ) ? name : name.substr( sep + 1 );
+	std::string dir;
 	for ( const auto &p: path )
 	{
-		try
+		dir = p;
+		if ( sep != std::string::npos )
 		{
-			Directory d( p );
-			if ( d.exists( filepath, name ) )
-				return true;
+			dir.push_back( pathSeparator() );
+			dir.append( name, 0, sep );
 		}
-		catch ( ... )
+		std::shared_ptr<const DirListing> l = getListing( dir );
+		if ( lookupEntry( *l, dir, leaf ) >= 0 )
 		{
+			filepath = dir;
+			filepath.push_back( pathSeparator() );
+			filepath.append( leaf );
+			return true;
 		}
 	}
 	return false;
@@ -398,19 +882,37 @@ find( std::string &filepath, const std::string &name,
 		const std::vector<std::string> &extensions,
 		const std::vector<std::string> &path )
 {
+	// each search directory is read once (and shared with every
+	// other lookup), after which each candidate is a hash probe. As
+	// above, a name with directories in it is looked up in the
+	// listing of the directory it ends up in
+	std::string::size_type sep = name.find_last_of( pathSeparator() );
+	std::string leaf = ( sep == std::string::npos ) ? name : name.substr( sep + 1 );
+	std::string dir, entry;
 	for ( const auto &p: path )
 	{
-		try
+		dir = p;
+		if ( sep != std::string::npos )
 		{
-			Directory d( p );
-			for ( const auto &e: extensions )
-			{
-				if ( d.exists( filepath, name + e ) )
-					return true;
-			}
+			dir.push_back( pathSeparator() );
+			dir.append( name, 0, sep );
 		}
-		catch ( ... )
+		std::shared_ptr<const DirListing> l = getListing( dir );
+		if ( l->missing )
+			continue;
+
+		for ( const auto &e: extensions )
 		{
+			entry = leaf;
+			entry.append( e );
+			if ( lookupEntry( *l, dir, entry ) >= 0 )
+			{
+				filepath.reserve( dir.size() + 1 + entry.size() );
+				filepath = dir;
+				filepath.push_back( pathSeparator() );
+				filepath.append( entry );
+				return true;
+			}
 		}
 	}
 	return false;
@@ -476,65 +978,23 @@ find( std::vector<std::string> progs,
 ////////////////////////////////////////
 
 
-std::string
-globToRegex( const std::string &pattern )
+std::vector<std::string>
+glob( const std::string &path, const std::string &pattern )
 {
-	std::string ret;
-	ret.reserve( pattern.size() );
-
-	/// @todo { Add more complex transformations - don't handle
-	/// sequence stuff like in zsh or anything complex like that
-	/// (i.e. foo{1..10} for sequences)
-	/// 
-	/// but can do common shell globbing (i.e. ?oo{a,b,c}_*.txt )
-	/// where the following transformations are applied:
-	///
-	/// ? == '.' --  means any character in regex
-	/// * == ".*" -- any sequence of chars
-	/// {a,b,c} is (a|b|c) -- meaning boolean or to match a, b, or c
-	/// }
-	
-	int inBrace = 0;
-	for ( char c: pattern )
-	{
-		switch ( c )
-		{
-			case '.':
-				ret.push_back( '\\' );
-				ret.push_back( '.' );
-				break;
-			case '*':
-				ret.push_back( '.' );
-				ret.push_back( '*' );
-				break;
-			case '?':
-				ret.push_back( '.' );
-				break;
-			case '{':
-				++inBrace;
-				ret.push_back( '(' );
-				break;
-			case ',':
-				if ( inBrace > 0 )
-					ret.push_back( '|' );
-				else
-					ret.push_back( ',' );
-				break;
-			case '}':
-				if ( inBrace > 0 )
-				{
-					--inBrace;
-					ret.push_back( ')' );
-				}
-				else
-					ret.push_back( c );
-				break;
-			default:
-				ret.push_back( c );
-				break;
-		}
+	GlobPattern g( pattern );
+	std::vector<std::string> ret;
+	std::shared_ptr<const DirListing> l = getListing( path );
+	if ( l->missing || l->unreadable )
+	{
+		WARNING( "path '" << path << "' does not exist globbing files" );
+		return ret;
 	}
 
+	for ( const auto &e: l->entries )
+	{
+		if ( ! isDotOrDotDot( e.first ) && g.matches( e.first ) )
+			ret.push_back( e.first );
+	}
 	return ret;
 }
 
@@ -543,86 +1003,79 @@ globToRegex( const std::string &pattern )
 
 
 std::vector<std::string>
-globRegex( const std::string &path, const std::string &pattern )
+globFiles( const std::string &root, const std::string &pattern,
+		   std::vector<std::string> &searched )
 {
-#ifdef WIN32
-	std::regex rexp( pattern, std::regex::icase );
-#else
-	std::regex rexp( pattern );
-#endif
-	std::vector<std::string> retval;
+	std::vector< std::vector<GlobPattern> > alts;
+	for ( const std::string &p: GlobPattern::expand( pattern ) )
+	{
+		std::vector<GlobPattern> segs;
+		for ( const std::string &s: String::split( p, '/' ) )
+		{
+			if ( s.empty() || s == "." )
+				continue;
+			// consecutive ** are the same as one
+			if ( s == "**" && ! segs.empty() && segs.back().isRecursive() )
+				continue;
+			segs.emplace_back( s );
+		}
+		if ( ! segs.empty() )
+			alts.emplace_back( std::move( segs ) );
+	}
 
-	DIR *d = ::opendir( path.c_str() );
-	if ( d )
+	std::vector<GlobNode> level;
+	for ( size_t a = 0; a != alts.size(); ++a )
+		level.push_back( { std::string(), a, 0 } );
+
+	// walk a level of the tree at a time, reading and matching the
+	// directories at each level in parallel, then sort the results
+	// so the order doesn't depend on the scheduling (or the order
+	// the file system happens to return the entries)
+	std::vector<std::string> found;
+	std::set<std::string> dirs;
+	std::set< std::tuple<std::string, size_t, size_t> > seen;
+	while ( ! level.empty() )
 	{
-		ON_EXIT{ ::closedir( d ); };
-			// glibc deprecates readdir_r in 2.24
-#if defined(__GNU_LIBRARY__) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 24 ) ) 
-		while ( true )
+		std::vector<GlobStep> steps( level.size() );
+		if ( level.size() > 1 && ThreadPool::threadCount() > 1 )
 		{
-			errno = 0;
-			struct dirent *result = ::readdir( d );
-			if ( result )
+			TaskGroup tasks;
+			for ( size_t i = 0; i != level.size(); ++i )
 			{
-				if ( result->d_name[0] == '.' )
-				{
-					if ( result->d_name[1] == '\0' ||
-						 ( result->d_name[1] == '.' && result->d_name[2] == '\0' ) )
-					{
-						continue;
-					}
-				}
-				if ( std::regex_match( result->d_name, rexp ) )
-				{
-					std::cout << "  -> matching " << result->d_name << std::endl;
-					retval.emplace_back( std::string( result->d_name ) );
-				}
-				continue;
+				const GlobNode *n = &( level[i] );
+				GlobStep *out = &( steps[i] );
+				const std::vector<GlobPattern> *segs = &( alts[n->alt] );
+				tasks.run( [&root, segs, n, out]() { globNode( root, *segs, *n, *out ); } );
 			}
-			else if ( errno != 0 )
-				throw std::system_error( errno, std::system_category(), "reading directory " + path );
-
-			// errno == 0, no result -> end of stream
-			break;
+			tasks.wait();
 		}
-#else
-		std::unique_ptr<uint8_t[]> rdBuf;
-		size_t allocSize = 0;
-		long name_max = fpathconf( dirfd( d ), _PC_NAME_MAX );
-		if ( name_max == -1 )
+		else
 		{
-#if defined(NAME_MAX)
-			name_max = (NAME_MAX > 255) ? NAME_MAX : 255;
-#else
-			name_max = 255;
-#endif
+			for ( size_t i = 0; i != level.size(); ++i )
+				globNode( root, alts[level[i].alt], level[i], steps[i] );
 		}
-		allocSize = std::max( sizeof(struct dirent), size_t( offsetof(struct dirent, d_name) + static_cast<size_t>( name_max ) + 1 ) );
-		rdBuf.reset( new uint8_t[allocSize] );
 
-		struct dirent *curDir = reinterpret_cast<struct dirent *>( rdBuf.get() );
-		struct dirent *cur = nullptr;
-		std::cout << " searching " << path << std::endl;
-		while ( readdir_r( d, curDir, &cur ) == 0 )
+		std::vector<GlobNode> next;
+		for ( GlobStep &s: steps )
 		{
-			if ( ! cur )
-				break;
-
-			if ( std::regex_match( cur->d_name, rexp ) )
+			std::move( s.found.begin(), s.found.end(), std::back_inserter( found ) );
+			dirs.insert( s.searched.begin(), s.searched.end() );
+			for ( GlobNode &n: s.next )
 			{
-				std::cout << "  -> matching " << cur->d_name << std::endl;
-				retval.emplace_back( std::string( cur->d_name ) );
+				if ( seen.insert( std::make_tuple( n.rel, n.alt, n.seg ) ).second )
+					next.emplace_back( std::move( n ) );
 			}
 		}
-#endif
-	}
-	else
-	{
-		/// @TODO: should this be fatal???
-		std::cout << "WARNING: path '" << path << "' does not exist globbing files" << std::endl;
+		level.swap( next );
 	}
 
-	return retval;
+	// each directory's entries are already sorted, so this is often
+	// in order already
+	if ( ! std::is_sorted( found.begin(), found.end() ) )
+		std::sort( found.begin(), found.end() );
+	found.erase( std::unique( found.begin(), found.end() ), found.end() );
+	searched.insert( searched.end(), dirs.begin(), dirs.end() );
+	return found;
 }
 
 
@@ -651,16 +1104,41 @@ getPath( void )
 ////////////////////////////////////////
 
 
-bool
-findExecutable( std::string &filepath, const std::string &name )
+static bool
+lookupExecutable( std::string &filepath, const std::string &name )
 {
-	initPath();
+	// anything with a directory in it depends on where we are
+	bool cacheable = name.find( pathSeparator() ) == std::string::npos;
+	if ( cacheable )
+	{
+		std::lock_guard<std::mutex> lk( theExeMutex );
+		theExeInputs.insert( thePath.begin(), thePath.end() );
+		ExeCache &c = exeCacheFor( thePath );
+		auto i = c.found.find( name );
+		if ( i != c.found.end() )
+		{
+			filepath = i->second;
+			if ( filepath.empty() )
+				return false;
+			theExeInputs.insert( filepath );
+			return true;
+		}
+	}
 
 	bool ret = find( filepath, name, thePath );
 #ifdef WIN32
 	if ( ! ret )
 		ret = find( filepath, name + ".exe", thePath );
 #endif
+
+	std::lock_guard<std::mutex> lk( theExeMutex );
+	if ( cacheable )
+	{
+		exeCacheFor( thePath ).found[name] = ret ? filepath : std::string();
+		theExeCacheDirty = true;
+	}
+	if ( ret )
+		theExeInputs.insert( filepath );
 	return ret;
 }
 
@@ -668,16 +1146,42 @@ findExecutable( std::string &filepath, const std::string &name )
 ////////////////////////////////////////
 
 
+bool
+findExecutable( std::string &filepath, const std::string &name )
+{
+	initPath();
+
+	return lookupExecutable( filepath, name );
+}
+
+
+////////////////////////////////////////
+
+
 std::map<std::string, std::string>
 findExecutables( std::vector<std::string> progs )
 {
 	initPath();
 
-#ifdef WIN32
-	return find( std::move( progs ), thePath, { ".exe" } );
-#endif
+	std::map<std::string, std::string> ret;
+	std::string filepath;
+	for ( auto &p: progs )
+	{
+		if ( lookupExecutable( filepath, p ) )
+			ret[p] = filepath;
+	}
+	return ret;
+}
+
+
+////////////////////////////////////////
+
 
-	return find( std::move( progs ), thePath );
+void
+addExecutableInputs( std::vector<std::string> &files )
+{
+	std::lock_guard<std::mutex> lk( theExeMutex );
+	files.insert( files.end(), theExeInputs.begin(), theExeInputs.end() );
 }
 
 
@@ -696,6 +1200,130 @@ getArgv0( void )
 	return theArgv0;
 }
 
+
+////////////////////////////////////////
+
+
+void
+setCacheDirectory( const std::string &d )
+{
+	theCacheDir = d;
+}
+
+const std::string &
+getCacheDirectory( void )
+{
+	return theCacheDir;
+}
+
+
+////////////////////////////////////////
+
+
+void
+writeExecutableCache( void )
+{
+	std::lock_guard<std::mutex> lk( theExeMutex );
+	if ( theExeCacheDirty && ! theCacheDir.empty() )
+	{
+		saveExeCaches();
+		theExeCacheDirty = false;
+	}
+}
+
+
+////////////////////////////////////////
+
+
+bool
+readCacheFile( const std::string &fn, std::string &contents )
+{
+	int fd = ::open( fn.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		return false;
+	ON_EXIT{ ::close( fd ); };
+
+	struct stat sb;
+	if ( ::fstat( fd, &sb ) != 0 )
+		return false;
+
+	contents.resize( static_cast<size_t>( sb.st_size ) );
+	size_t pos = 0;
+	while ( pos < contents.size() )
+	{
+		ssize_t nr = ::read( fd, &contents[pos], contents.size() - pos );
+		if ( nr < 0 && errno == EINTR )
+			continue;
+		if ( nr <= 0 )
+			return false;
+		pos += static_cast<size_t>( nr );
+	}
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+void
+writeCacheFile( const std::string &fn, const std::string &contents )
+{
+	::mkdir( theCacheDir.c_str(), 0777 );
+	std::string::size_type sep = fn.find_last_of( pathSeparator() );
+	if ( sep != std::string::npos && sep > theCacheDir.size() )
+		::mkdir( fn.substr( 0, sep ).c_str(), 0777 );
+
+	std::stringstream tmpfn;
+	tmpfn << fn << '.' << ::getpid() << '.' << std::this_thread::get_id();
+	{
+		std::ofstream outf( tmpfn.str(), std::ios::binary );
+		outf.write( contents.data(), static_cast<std::streamsize>( contents.size() ) );
+		if ( ! outf )
+		{
+			outf.close();
+			::unlink( tmpfn.str().c_str() );
+			return;
+		}
+	}
+	if ( ::rename( tmpfn.str().c_str(), fn.c_str() ) != 0 )
+		::unlink( tmpfn.str().c_str() );
+}
+
+
+////////////////////////////////////////
+
+
+uint64_t
+hashBytes( const char *p, size_t n, uint64_t h )
+{
+	for ( size_t i = 0; i != n; ++i )
+	{
+		h ^= static_cast<uint8_t>( p[i] );
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+modTime( const std::string &path, int64_t &sec, int64_t &nsec )
+{
+	struct stat sb;
+	if ( ::stat( path.c_str(), &sb ) != 0 )
+		return false;
+#ifdef __APPLE__
+	sec = static_cast<int64_t>( sb.st_mtimespec.tv_sec );
+	nsec = static_cast<int64_t>( sb.st_mtimespec.tv_nsec );
+#else
+	sec = static_cast<int64_t>( sb.st_mtim.tv_sec );
+	nsec = static_cast<int64_t>( sb.st_mtim.tv_nsec );
+#endif
+	return true;
+}
+
 } // namespace File
 
 
@@ -25,6 +25,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 
 
 ////////////////////////////////////////
@@ -47,6 +48,19 @@ bool isAbsolute( const char *path );
 bool exists( const char *path );
 bool isDirectory( const char *path );
 
+/// All existence checks go through a per-run cache which reads whole
+/// directories at a time (one opendir / readdir pass instead of a
+/// stat for every name tried), and only falls back to stat for
+/// symlinks and entries the file system doesn't type. Returns
+/// whether the (absolute) path exists and if so, whether it is a
+/// directory
+bool cachedStat( const std::string &path, bool &isDir );
+/// forget anything cached about the path (and its directory), for
+/// when we create or remove files ourselves
+void invalidateStatCache( const std::string &path );
+/// prints (verbose) how many system calls the cache saved
+void reportStatCache( void );
+
 std::string basename( const std::string &fn );
 std::string extension( const std::string &fn );
 std::string replaceExtension( const std::string &fn, const std::string &newext );
@@ -75,24 +89,55 @@ find( std::vector<std::string> progs,
 	  const std::vector<std::string> &path,
 	  const std::vector<std::string> &extensions = std::vector<std::string>() );
 
-/// Converts a shell-like glob pattern to a regex useful
-/// for standard regex match utility as best as possible
-std::string globToRegex( const std::string &pattern );
-std::vector<std::string> globRegex( const std::string &path, const std::string &regexPattern );
+/// returns the (sorted) entries of path matching a single component
+/// glob pattern, see GlobPattern
+std::vector<std::string> glob( const std::string &path, const std::string &pattern );
 
-inline std::vector<std::string> glob( const std::string &path, const std::string &pattern )
-{
-	return globRegex( path, globToRegex( pattern ) );
-}
+/// Matches a '/' separated glob pattern below root, where each
+/// component may use ?, * and [a-z] classes, {a,b} alternation may
+/// span components, and a ** component matches any number of
+/// (non-hidden) directories, or as the last component, all the files
+/// below. Directories at the same depth are read
+/// in parallel. Returns the matching paths relative to root in
+/// sorted order, adding the directories which were searched with a
+/// wildcard (whose contents changing would change the result) to
+/// searched
+std::vector<std::string> globFiles( const std::string &root, const std::string &pattern,
+									std::vector<std::string> &searched );
 
 
 void setPathOverride( const std::vector<std::string> &p );
 const std::vector<std::string> &getPath( void );
 bool findExecutable( std::string &filepath, const std::string &name );
 std::map<std::string, std::string> findExecutables( std::vector<std::string> progs );
+/// executable lookups are remembered per search path for the run,
+/// and (once a cache directory is set) between runs, as long as
+/// none of the search path directories have changed. This writes
+/// out anything newly found
+void writeExecutableCache( void );
+/// appends the search directories and programs the executable
+/// lookups of this run depended on, for the caches of the evaluation
+void addExecutableInputs( std::vector<std::string> &files );
 
 void setArgv0( const std::string &a );
 const std::string &getArgv0( void );
 
+/// Directory (under the build tree) used to persist data between
+/// runs. An empty string disables any on-disk caching
+void setCacheDirectory( const std::string &d );
+const std::string &getCacheDirectory( void );
+
+/// reads a whole file from the cache directory, returning false if
+/// it is missing or unreadable
+bool readCacheFile( const std::string &fn, std::string &contents );
+/// replaces a file in (a sub-directory of) the cache directory by
+/// writing a temporary and renaming it into place. Failures are
+/// ignored, the caches are only an optimization
+void writeCacheFile( const std::string &fn, const std::string &contents );
+/// FNV-1a hash, used to name and validate cache entries
+uint64_t hashBytes( const char *p, size_t n, uint64_t h = 14695981039346656037ULL );
+/// modification time of the path, returns false if it does not exist
+bool modTime( const std::string &path, int64_t &sec, int64_t &nsec );
+
 } // namespace File
 
@@ -0,0 +1,524 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "FlagList.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+// below this a linear scan is faster than maintaining the hash
+static const size_t theIndexThreshold = 16;
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+const std::vector<std::string> FlagList::theNoValues;
+const std::string FlagList::theNoText;
+
+
+////////////////////////////////////////
+
+
+bool
+FlagList::contains( const std::string &v ) const
+{
+	if ( ! myData )
+		return false;
+	if ( myData->indexed )
+		return myData->counts.find( v ) != myData->counts.end();
+	return std::find( myData->values.begin(), myData->values.end(), v ) != myData->values.end();
+}
+
+
+////////////////////////////////////////
+
+
+const std::string &
+FlagList::joined( const std::string &prefix ) const
+{
+	if ( ! myData )
+		return theNoText;
+
+	Data &d = *myData;
+	std::lock_guard<std::mutex> lk( d.joinedMutex );
+	for ( const Joined &j: d.joined )
+	{
+		if ( j.prefix == prefix )
+			return j.text;
+	}
+
+	d.joined.emplace_front();
+	Joined &j = d.joined.front();
+	j.prefix = prefix;
+	for ( const std::string &v: d.values )
+	{
+		if ( v.empty() )
+			continue;
+		if ( ! j.text.empty() )
+			j.text.push_back( ' ' );
+		if ( v.compare( 0, prefix.size(), prefix ) != 0 )
+			j.text.append( prefix );
+		j.text.append( v );
+	}
+	return j.text;
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::clear( void )
+{
+	myData.reset();
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::assign( std::vector<std::string> v )
+{
+	if ( v.empty() )
+	{
+		myData.reset();
+		return;
+	}
+
+	myData = std::make_shared<Data>();
+	myData->values = std::move( v );
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::push_back( std::string v )
+{
+	Data &d = mutate();
+	d.values.emplace_back( std::move( v ) );
+	if ( d.indexed )
+		++d.counts[d.values.back()];
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::append( std::vector<std::string> &&v )
+{
+	if ( v.empty() )
+		return;
+	if ( ! myData )
+	{
+		assign( std::move( v ) );
+		return;
+	}
+
+	Data &d = mutate();
+	size_t start = d.values.size();
+	d.values.reserve( start + v.size() );
+	std::move( v.begin(), v.end(), std::back_inserter( d.values ) );
+	if ( d.indexed )
+	{
+		for ( size_t i = start; i < d.values.size(); ++i )
+			++d.counts[d.values[i]];
+	}
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::append( const std::vector<std::string> &v )
+{
+	append( std::vector<std::string>( v ) );
+}
+
+
+////////////////////////////////////////
+
+
+bool
+FlagList::addIfMissing( const std::string &v )
+{
+	if ( v.empty() || lookup( v ) )
+		return false;
+
+	push_back( v );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::addIfMissing( const std::vector<std::string> &v )
+{
+	for ( const std::string &i: v )
+		addIfMissing( i );
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::moveToEnd( const std::string &v )
+{
+	if ( v.empty() )
+		return;
+
+	if ( lookup( v ) )
+	{
+		Data &d = mutate();
+		d.values.erase( std::remove( d.values.begin(), d.values.end(), v ),
+						d.values.end() );
+		if ( d.indexed )
+			d.counts.erase( v );
+	}
+	push_back( v );
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::moveToEnd( const std::vector<std::string> &v )
+{
+	// the common case of merging a couple of flags in to a short
+	// list isn't worth the hashing
+	if ( v.size() * size() < theIndexThreshold * theIndexThreshold )
+	{
+		for ( const std::string &i: v )
+			moveToEnd( i );
+		return;
+	}
+
+	// moving each in turn leaves the values not being moved in their
+	// order, followed by the moved ones in the order of their last
+	// appearance in v
+	std::unordered_map<std::string, size_t> lastPos;
+	lastPos.reserve( v.size() );
+	for ( size_t i = 0; i != v.size(); ++i )
+	{
+		if ( ! v[i].empty() )
+			lastPos[v[i]] = i;
+	}
+	if ( lastPos.empty() )
+		return;
+
+	Data &d = mutate();
+	std::vector<bool> keep( d.values.size() );
+	bool any = false;
+	for ( size_t i = 0; i != d.values.size(); ++i )
+	{
+		keep[i] = lastPos.find( d.values[i] ) == lastPos.end();
+		any = any || ! keep[i];
+	}
+	if ( any )
+		compact( d, keep );
+
+	d.values.reserve( d.values.size() + lastPos.size() );
+	for ( size_t i = 0; i != v.size(); ++i )
+	{
+		if ( v[i].empty() )
+			continue;
+		auto l = lastPos.find( v[i] );
+		if ( l->second == i )
+			push_back( v[i] );
+	}
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::moveToEnd( const FlagList &v )
+{
+	if ( ! v.myData )
+		return;
+	if ( v.myData == myData )
+	{
+		moveToEnd( std::vector<std::string>( v.values() ) );
+		return;
+	}
+
+	const std::vector<std::string> &vals = v.values();
+
+	// with duplicates in v the order of the moved values is that of
+	// their last appearance, leave that (and long lists without an
+	// index to check) to the general version
+	bool unique;
+	if ( v.myData->indexed )
+		unique = v.myData->counts.size() == vals.size();
+	else if ( vals.size() >= theIndexThreshold )
+		unique = false;
+	else
+	{
+		unique = true;
+		for ( size_t i = 0; unique && i < vals.size(); ++i )
+			unique = std::find( vals.begin() + static_cast<std::ptrdiff_t>( i + 1 ),
+								vals.end(), vals[i] ) == vals.end();
+	}
+	if ( ! unique )
+	{
+		moveToEnd( vals );
+		return;
+	}
+
+	if ( ! myData )
+	{
+		// nothing to remove, so unless there are empty values to skip
+		// the result is v and can share its storage
+		if ( std::find( vals.begin(), vals.end(), std::string() ) == vals.end() )
+		{
+			myData = v.myData;
+			return;
+		}
+	}
+	else
+	{
+		const std::vector<std::string> &cur = myData->values;
+		std::vector<bool> keep( cur.size() );
+		bool any = false;
+		for ( size_t i = 0; i != cur.size(); ++i )
+		{
+			// empty values are never moved
+			keep[i] = cur[i].empty() || ! v.contains( cur[i] );
+			any = any || ! keep[i];
+		}
+		if ( any )
+			compact( mutate(), keep );
+	}
+
+	Data &d = mutate();
+	d.values.reserve( d.values.size() + vals.size() );
+	for ( const std::string &i: vals )
+	{
+		if ( i.empty() )
+			continue;
+		d.values.push_back( i );
+		if ( d.indexed )
+			++d.counts[i];
+	}
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::removeDuplicatesKeepLast( void )
+{
+	if ( ! myData )
+		return;
+
+	std::unordered_map<std::string, uint32_t> remaining;
+	if ( myData->indexed )
+		remaining = myData->counts;
+	else
+	{
+		for ( const std::string &v: myData->values )
+			++remaining[v];
+	}
+	if ( remaining.size() == myData->values.size() )
+		return;
+
+	Data &d = mutate();
+	std::vector<bool> keep( d.values.size() );
+	for ( size_t i = 0; i != d.values.size(); ++i )
+		keep[i] = ( --remaining[d.values[i]] == 0 );
+	compact( d, keep );
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::removeDuplicates( const std::map<std::string, bool> &prefixDisposition )
+{
+	if ( ! myData )
+		return;
+
+	std::unordered_map<std::string, uint32_t> total;
+	if ( myData->indexed )
+		total = myData->counts;
+	else
+	{
+		for ( const std::string &v: myData->values )
+			++total[v];
+	}
+	if ( total.size() == myData->values.size() )
+		return;
+
+	Data &d = mutate();
+	std::unordered_map<std::string, uint32_t> remaining = total;
+	std::vector<bool> keep( d.values.size(), true );
+	for ( size_t i = 0; i != d.values.size(); ++i )
+	{
+		const std::string &cur = d.values[i];
+		uint32_t n = total[cur];
+		if ( n == 1 )
+			continue;
+
+		uint32_t &left = remaining[cur];
+		for ( auto &x: prefixDisposition )
+		{
+			if ( cur.compare( 0, x.first.size(), x.first ) == 0 )
+			{
+				keep[i] = x.second ? ( left == n ) : ( left == 1 );
+				break;
+			}
+		}
+		--left;
+	}
+	compact( d, keep );
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::Usage::add( const FlagList &l )
+{
+	if ( ! l.myData )
+		return;
+
+	const Data &d = *( l.myData );
+	size_t bytes = sizeof(Data) + d.values.capacity() * sizeof(std::string);
+	for ( const std::string &v: d.values )
+	{
+		// the short ones are stored in the string itself
+		if ( v.capacity() >= sizeof(std::string) )
+			bytes += v.capacity() + 1;
+	}
+	if ( d.indexed )
+	{
+		bytes += d.counts.bucket_count() * sizeof(void *);
+		for ( const auto &c: d.counts )
+			bytes += sizeof(c) + sizeof(void *) + ( c.first.capacity() >= sizeof(std::string) ? c.first.capacity() + 1 : 0 );
+	}
+
+	++myReferences;
+	myUnsharedBytes += bytes;
+	if ( mySeen.insert( l.myData.get() ).second )
+		myBytes += bytes;
+}
+
+
+////////////////////////////////////////
+
+
+FlagList::Data &
+FlagList::mutate( void )
+{
+	if ( ! myData )
+		myData = std::make_shared<Data>();
+	else if ( myData.use_count() > 1 )
+	{
+		// the copy starts without the index, most copies that change
+		// only have a few flags added
+		std::shared_ptr<Data> d = std::make_shared<Data>();
+		d->values = myData->values;
+		myData = std::move( d );
+	}
+	else
+		myData->joined.clear();
+	return *myData;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+FlagList::lookup( const std::string &v )
+{
+	if ( myData && ! myData->indexed && myData->values.size() >= theIndexThreshold )
+		buildIndex( mutate() );
+	return contains( v );
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::buildIndex( Data &d )
+{
+	d.counts.clear();
+	d.counts.reserve( d.values.size() * 2 );
+	for ( const std::string &v: d.values )
+		++d.counts[v];
+	d.indexed = true;
+}
+
+
+////////////////////////////////////////
+
+
+void
+FlagList::compact( Data &d, const std::vector<bool> &keep )
+{
+	size_t out = 0;
+	for ( size_t i = 0; i != d.values.size(); ++i )
+	{
+		if ( keep[i] )
+		{
+			if ( out != i )
+				d.values[out] = std::move( d.values[i] );
+			++out;
+			continue;
+		}
+
+		if ( d.indexed )
+		{
+			auto c = d.counts.find( d.values[i] );
+			if ( --c->second == 0 )
+				d.counts.erase( c );
+		}
+	}
+	d.values.resize( out );
+}
+
+
+////////////////////////////////////////
@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <forward_list>
+#include <cstdint>
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Class FlagList holds the values of a variable in order, with
+/// an index of how many times each value appears so the membership
+/// checks done while propagating flags don't scan the list.
+///
+/// The index is built by the first lookup once the list reaches a
+/// handful of entries and kept up to date from then on. Below that a
+/// scan is cheaper than the hashing, and lists that are only appended
+/// to (and copies of them) never pay for it. Removals compact the
+/// values in one pass, so values() is always the plain list.
+///
+/// The storage is shared between copies and only copied when one of
+/// them is changed, as the flags propagated from the libraries are
+/// handed to every object of the executable or library using them.
+/// The values joined for the generators are kept with it, so each
+/// shared list is only joined once.
+///
+class FlagList
+{
+public:
+	FlagList( void ) = default;
+	~FlagList( void ) = default;
+	FlagList( const FlagList & ) = default;
+	FlagList( FlagList && ) = default;
+	FlagList &operator=( const FlagList & ) = default;
+	FlagList &operator=( FlagList && ) = default;
+
+	inline const std::vector<std::string> &values( void ) const;
+	inline bool empty( void ) const;
+	inline size_t size( void ) const;
+
+	bool contains( const std::string &v ) const;
+
+	/// the values separated by spaces, with the prefix added to those
+	/// not starting with it. Stays valid until the list is changed
+	const std::string &joined( const std::string &prefix ) const;
+
+	void clear( void );
+	void assign( std::vector<std::string> v );
+	void push_back( std::string v );
+	void append( std::vector<std::string> &&v );
+	void append( const std::vector<std::string> &v );
+
+	/// appends the value if it isn't already there, returning true
+	/// if it was added
+	bool addIfMissing( const std::string &v );
+	void addIfMissing( const std::vector<std::string> &v );
+
+	/// removes every copy of the value and puts it at the end
+	void moveToEnd( const std::string &v );
+	/// same as calling moveToEnd for each value in turn, but in one
+	/// pass over the list
+	void moveToEnd( const std::vector<std::string> &v );
+	/// as above, using the other list's index when it has one
+	void moveToEnd( const FlagList &v );
+
+	/// removes duplicates, keeping the last entry, otherwise the
+	/// relative order is unchanged
+	void removeDuplicatesKeepLast( void );
+	/// removes duplicates of the values with one of the prefixes,
+	/// keeping the first (true) or last (false) entry
+	void removeDuplicates( const std::map<std::string, bool> &prefixDisposition );
+
+	inline bool operator==( const FlagList &o ) const;
+	inline bool operator!=( const FlagList &o ) const;
+
+	/// identifies the storage shared by copies, so the caches can
+	/// write it once
+	inline const void *storage( void ) const { return myData.get(); }
+
+	/// adds up the memory used by a number of lists for --stats,
+	/// counting shared storage once
+	class Usage
+	{
+	public:
+		void add( const FlagList &l );
+
+		inline size_t references( void ) const { return myReferences; }
+		inline size_t lists( void ) const { return mySeen.size(); }
+		inline size_t bytes( void ) const { return myBytes; }
+		/// what the lists would use if each had a copy
+		inline size_t unsharedBytes( void ) const { return myUnsharedBytes; }
+
+	private:
+		std::unordered_set<const void *> mySeen;
+		size_t myReferences = 0;
+		size_t myBytes = 0;
+		size_t myUnsharedBytes = 0;
+	};
+
+private:
+	struct Joined
+	{
+		std::string prefix;
+		std::string text;
+	};
+	struct Data
+	{
+		std::vector<std::string> values;
+		std::unordered_map<std::string, uint32_t> counts;
+		bool indexed = false;
+		// the configurations are emitted in parallel from copies
+		// sharing this
+		std::mutex joinedMutex;
+		std::forward_list<Joined> joined;
+	};
+
+	// the storage to change, copied first if it is shared
+	Data &mutate( void );
+	bool lookup( const std::string &v );
+	void buildIndex( Data &d );
+	// keeps the values whose flag is set, in order
+	void compact( Data &d, const std::vector<bool> &keep );
+
+	// null while empty
+	std::shared_ptr<Data> myData;
+
+	static const std::vector<std::string> theNoValues;
+	static const std::string theNoText;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+inline const std::vector<std::string> &
+FlagList::values( void ) const
+{
+	return myData ? myData->values : theNoValues;
+}
+inline bool FlagList::empty( void ) const { return values().empty(); }
+inline size_t FlagList::size( void ) const { return values().size(); }
+
+
+////////////////////////////////////////
+
+
+inline bool
+FlagList::operator==( const FlagList &o ) const
+{
+	return myData == o.myData || values() == o.values();
+}
+inline bool
+FlagList::operator!=( const FlagList &o ) const
+{
+	return !( *this == o );
+}
+
+
@@ -0,0 +1,348 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "GlobManifest.h"
+#include "FileUtil.h"
+#include "CacheData.h"
+#include "LuaEngine.h"
+#include "PackageSet.h"
+#include "Debug.h"
+
+#include <vector>
+#include <set>
+#include <mutex>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/time.h>
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+static const char theManifestMagic[8] = { 'C', 'T', 'O', 'R', 'G', 'L', 'B', '3' };
+static std::mutex theOutputMutex;
+static std::vector<std::string> theOutputs;
+// the external inputs of an evaluation restored from a cache, which
+// still apply to anything written this run
+static std::mutex theExternalMutex;
+static std::vector<std::string> theRestoredExternal;
+
+static std::string
+manifestFile( void )
+{
+	return File::getCacheDirectory() + File::pathSeparator() + "globs";
+}
+
+
+////////////////////////////////////////
+
+
+struct Inputs
+{
+	std::vector<std::string> files;
+	std::vector< std::pair<int64_t, int64_t> > times;
+	std::vector<Lua::Engine::GlobRecord> globs;
+	// looked at outside the construct files (.pc files, the
+	// directories searched for packages and programs), these are
+	// checked but aren't dependencies of the build files
+	std::vector<std::string> external;
+	std::vector< std::pair<int64_t, int64_t> > externalTimes;
+};
+
+static void
+putFiles( std::string &out, const std::vector<std::string> &files )
+{
+	CacheData::put( out, files );
+	for ( const std::string &f: files )
+	{
+		int64_t sec = -1, nsec = -1;
+		File::modTime( f, sec, nsec );
+		CacheData::put( out, sec );
+		CacheData::put( out, nsec );
+	}
+}
+
+static bool
+getFiles( CacheData::Reader &rdr, std::vector<std::string> &files,
+		  std::vector< std::pair<int64_t, int64_t> > &times )
+{
+	if ( ! rdr.get( files ) )
+		return false;
+	for ( size_t i = 0; i != files.size(); ++i )
+	{
+		int64_t sec, nsec;
+		if ( ! rdr.get( sec ) || ! rdr.get( nsec ) )
+			return false;
+		times.emplace_back( sec, nsec );
+	}
+	return true;
+}
+
+static bool
+filesCurrent( const std::vector<std::string> &files,
+			  const std::vector< std::pair<int64_t, int64_t> > &times )
+{
+	for ( size_t i = 0; i != files.size(); ++i )
+	{
+		int64_t cursec = -1, curnsec = -1;
+		File::modTime( files[i], cursec, curnsec );
+		if ( cursec != times[i].first || curnsec != times[i].second )
+		{
+			VERBOSE( files[i] << " changed - regenerating" );
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool
+readInputs( CacheData::Reader &rdr, Inputs &in )
+{
+	if ( ! getFiles( rdr, in.files, in.times ) )
+		return false;
+
+	int64_t nGlobs;
+	if ( ! rdr.get( nGlobs ) || nGlobs < 0 )
+		return false;
+	for ( int64_t i = 0; i < nGlobs; ++i )
+	{
+		Lua::Engine::GlobRecord g;
+		if ( ! rdr.get( g.root ) || ! rdr.get( g.pattern ) || ! rdr.get( g.matches ) ||
+			 ! rdr.get( g.searched ) )
+			return false;
+		in.globs.emplace_back( std::move( g ) );
+	}
+	return getFiles( rdr, in.external, in.externalTimes );
+}
+
+static bool
+inputsCurrent( const Inputs &in )
+{
+	if ( ! filesCurrent( in.files, in.times ) ||
+		 ! filesCurrent( in.external, in.externalTimes ) )
+		return false;
+
+	for ( const auto &g: in.globs )
+	{
+		std::vector<std::string> searched;
+		if ( File::globFiles( g.root, g.pattern, searched ) != g.matches )
+		{
+			VERBOSE( "glob '" << g.pattern << "' in " << g.root << " changed - regenerating" );
+			return false;
+		}
+	}
+	return true;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+namespace GlobManifest
+{
+
+
+////////////////////////////////////////
+
+
+void
+addOutput( const std::string &fn )
+{
+	std::lock_guard<std::mutex> lk( theOutputMutex );
+	theOutputs.push_back( fn );
+}
+
+
+////////////////////////////////////////
+
+
+void
+write( const std::string &cmdline )
+{
+	if ( File::getCacheDirectory().empty() )
+		return;
+
+	std::string out( theManifestMagic, sizeof(theManifestMagic) );
+	CacheData::put( out, cmdline );
+	{
+		std::lock_guard<std::mutex> lk( theOutputMutex );
+		CacheData::put( out, theOutputs );
+	}
+
+	putInputs( out );
+	File::writeCacheFile( manifestFile(), out );
+}
+
+
+////////////////////////////////////////
+
+
+void
+putInputs( std::string &out )
+{
+	Lua::Engine &eng = Lua::Engine::singleton();
+	const std::vector<Lua::Engine::GlobRecord> &globs = eng.globs();
+
+	// directories only visited because a glob searched them are
+	// covered by re-running the glob
+	std::set<std::string> globDirs;
+	for ( const auto &g: globs )
+		globDirs.insert( g.searched.begin(), g.searched.end() );
+
+	std::vector<std::string> files;
+	for ( const std::string &f: eng.visitedFiles() )
+	{
+		if ( globDirs.find( f ) == globDirs.end() )
+			files.push_back( f );
+	}
+	putFiles( out, files );
+
+	CacheData::put( out, static_cast<int64_t>( globs.size() ) );
+	for ( const auto &g: globs )
+	{
+		CacheData::put( out, g.root );
+		CacheData::put( out, g.pattern );
+		CacheData::put( out, g.matches );
+		CacheData::put( out, g.searched );
+	}
+
+	std::vector<std::string> external;
+	PackageSet::addInputs( external );
+	File::addExecutableInputs( external );
+	{
+		std::lock_guard<std::mutex> lk( theExternalMutex );
+		external.insert( external.end(), theRestoredExternal.begin(), theRestoredExternal.end() );
+	}
+	std::sort( external.begin(), external.end() );
+	external.erase( std::unique( external.begin(), external.end() ), external.end() );
+	putFiles( out, external );
+}
+
+
+////////////////////////////////////////
+
+
+bool
+restoreInputs( CacheData::Reader &rdr )
+{
+	Inputs in;
+	if ( ! readInputs( rdr, in ) || ! inputsCurrent( in ) )
+		return false;
+
+	Lua::Engine &eng = Lua::Engine::singleton();
+	for ( const std::string &f: in.files )
+		eng.addVisitedFile( f );
+	for ( auto &g: in.globs )
+	{
+		for ( const std::string &d: g.searched )
+			eng.addVisitedFile( d );
+		eng.addGlob( std::move( g ) );
+	}
+	std::lock_guard<std::mutex> lk( theExternalMutex );
+	theRestoredExternal = std::move( in.external );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+upToDate( const std::string &cmdline )
+{
+	if ( File::getCacheDirectory().empty() )
+		return false;
+
+	std::string data;
+	if ( ! File::readCacheFile( manifestFile(), data ) ||
+		 data.compare( 0, sizeof(theManifestMagic), theManifestMagic, sizeof(theManifestMagic) ) != 0 )
+		return false;
+
+	CacheData::Reader rdr( data, sizeof(theManifestMagic) );
+	std::string lastCmd;
+	std::vector<std::string> outputs;
+	Inputs in;
+	if ( ! rdr.get( lastCmd ) || lastCmd != cmdline ||
+		 ! rdr.get( outputs ) || outputs.empty() ||
+		 ! readInputs( rdr, in ) || ! inputsCurrent( in ) )
+		return false;
+
+	for ( const std::string &o: outputs )
+	{
+		bool isDir = false;
+		if ( ! File::cachedStat( o, isDir ) )
+			return false;
+	}
+
+	// nothing the build files depend on changed, just bring them up
+	// to date with the directories the globs searched
+	for ( const std::string &o: outputs )
+	{
+		if ( ::utimes( o.c_str(), nullptr ) != 0 )
+			return false;
+	}
+
+	VERBOSE( "Build files up to date, " << in.globs.size() << " globs unchanged" );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+watchList( const std::string &cmdline,
+		   std::vector<std::string> &files,
+		   std::vector<std::string> &dirs )
+{
+	std::string data;
+	if ( File::getCacheDirectory().empty() ||
+		 ! File::readCacheFile( manifestFile(), data ) ||
+		 data.compare( 0, sizeof(theManifestMagic), theManifestMagic, sizeof(theManifestMagic) ) != 0 )
+		return false;
+
+	CacheData::Reader rdr( data, sizeof(theManifestMagic) );
+	std::string lastCmd;
+	std::vector<std::string> outputs;
+	Inputs in;
+	if ( ! rdr.get( lastCmd ) || lastCmd != cmdline ||
+		 ! rdr.get( outputs ) || ! readInputs( rdr, in ) )
+		return false;
+
+	files = std::move( in.files );
+	for ( const auto &g: in.globs )
+		dirs.insert( dirs.end(), g.searched.begin(), g.searched.end() );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+} // namespace GlobManifest
+
+
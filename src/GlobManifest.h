@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace CacheData { class Reader; }
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Records what a generation depended on, so an automatic
+/// regeneration can skip re-evaluating the build tree.
+///
+/// Every directory a glob searches is a dependency of the build
+/// files, so adding any file (even one no glob would match) triggers
+/// a regeneration. The manifest keeps each glob's pattern and
+/// matches, along with the modification times of the other files
+/// visited (the construct files and such), and of what the
+/// evaluation looked at outside the tree (the .pc files read and the
+/// directories searched for packages and programs). When none of
+/// those changed and every glob still matches the same files, the
+/// build files are just touched instead of regenerated.
+///
+namespace GlobManifest
+{
+
+/// a generated build file which depends on the visited files
+void addOutput( const std::string &fn );
+
+/// writes the manifest for the run (identified by the command line)
+/// to the cache directory
+void write( const std::string &cmdline );
+
+/// appends the visited files (with their modification times), the
+/// globs and the external inputs of this run, for other caches of
+/// the evaluation
+void putInputs( std::string &out );
+
+/// reads back what putInputs wrote. If none of the files changed and
+/// every glob still matches the same files, they are recorded with
+/// the lua engine as though this run had visited them and true is
+/// returned
+bool restoreInputs( CacheData::Reader &rdr );
+
+/// returns true (having touched the build files) if the last run
+/// with the same command line is still up to date
+bool upToDate( const std::string &cmdline );
+
+/// the visited files and the directories searched by the globs of
+/// the last run with the same command line, for something watching
+/// for changes. Returns false if there is no such manifest
+bool watchList( const std::string &cmdline,
+				std::vector<std::string> &files,
+				std::vector<std::string> &dirs );
+
+} // namespace GlobManifest
+
+
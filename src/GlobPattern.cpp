@@ -0,0 +1,345 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "GlobPattern.h"
+#include <cctype>
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+inline unsigned char
+fold( char c )
+{
+#ifdef WIN32
+	return static_cast<unsigned char>( ::tolower( static_cast<unsigned char>( c ) ) );
+#else
+	return static_cast<unsigned char>( c );
+#endif
+}
+
+// finds the ] closing the class opened at pos, or npos if it isn't
+// closed (in which case the [ is just a character)
+size_t
+classEnd( const std::string &p, size_t pos )
+{
+	size_t i = pos + 1;
+	if ( i < p.size() && ( p[i] == '!' || p[i] == '^' ) )
+		++i;
+	// a leading ] is part of the class
+	if ( i < p.size() && p[i] == ']' )
+		++i;
+	for ( ; i < p.size(); ++i )
+	{
+		if ( p[i] == ']' )
+			return i;
+	}
+	return std::string::npos;
+}
+
+// finds the } closing the brace opened at pos, filling in the
+// top-level alternatives
+size_t
+braceEnd( const std::string &p, size_t pos, std::vector<std::string> &alts )
+{
+	int depth = 0;
+	size_t start = pos + 1;
+	for ( size_t i = pos + 1; i < p.size(); ++i )
+	{
+		switch ( p[i] )
+		{
+			case '\\':
+				++i;
+				break;
+			case '{':
+				++depth;
+				break;
+			case '}':
+				if ( depth == 0 )
+				{
+					alts.push_back( p.substr( start, i - start ) );
+					return i;
+				}
+				--depth;
+				break;
+			case ',':
+				if ( depth == 0 )
+				{
+					alts.push_back( p.substr( start, i - start ) );
+					start = i + 1;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	alts.clear();
+	return std::string::npos;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+GlobPattern::GlobPattern( const std::string &pattern )
+		: myPattern( pattern )
+{
+	if ( pattern == "**" )
+	{
+		myRecursive = true;
+		myLiteral = false;
+		return;
+	}
+
+	for ( size_t i = 0; i < pattern.size(); ++i )
+	{
+		char c = pattern[i];
+		switch ( c )
+		{
+			case '?':
+				myAtoms.push_back( { Op::ANY, '\0', 0 } );
+				break;
+			case '*':
+				// runs of * are the same as one
+				if ( myAtoms.empty() || myAtoms.back().op != Op::STAR )
+					myAtoms.push_back( { Op::STAR, '\0', 0 } );
+				break;
+			case '[':
+			{
+				size_t e = classEnd( pattern, i );
+				if ( e == std::string::npos )
+				{
+					myAtoms.push_back( { Op::CHAR, c, 0 } );
+					break;
+				}
+				std::bitset<256> cls;
+				size_t j = i + 1;
+				bool negate = false;
+				if ( pattern[j] == '!' || pattern[j] == '^' )
+				{
+					negate = true;
+					++j;
+				}
+				for ( size_t first = j; j < e; ++j )
+				{
+					if ( pattern[j] == ']' && j != first )
+						break;
+					unsigned char lo = fold( pattern[j] );
+					if ( j + 2 < e && pattern[j + 1] == '-' )
+					{
+						unsigned char hi = fold( pattern[j + 2] );
+						for ( unsigned v = lo; v <= hi; ++v )
+							cls.set( v );
+						j += 2;
+					}
+					else
+						cls.set( lo );
+				}
+				if ( negate )
+					cls.flip();
+				myAtoms.push_back( { Op::CLASS, '\0', myClasses.size() } );
+				myClasses.push_back( cls );
+				i = e;
+				break;
+			}
+			case '\\':
+				if ( i + 1 < pattern.size() )
+					c = pattern[++i];
+				myAtoms.push_back( { Op::CHAR, c, 0 } );
+				break;
+			default:
+				myAtoms.push_back( { Op::CHAR, c, 0 } );
+				break;
+		}
+	}
+
+	for ( const Atom &a: myAtoms )
+	{
+		if ( a.op != Op::CHAR )
+			myLiteral = false;
+		if ( a.op != Op::STAR )
+			++myMinLength;
+	}
+
+	for ( const Atom &a: myAtoms )
+	{
+		if ( a.op != Op::CHAR )
+			break;
+		myPrefix.push_back( a.c );
+	}
+	if ( myLiteral )
+	{
+		// back to the unescaped name so it can be looked up directly
+		myPattern = myPrefix;
+		myPrefix.clear();
+		return;
+	}
+	for ( auto a = myAtoms.rbegin(); a != myAtoms.rend() && a->op == Op::CHAR; ++a )
+		mySuffix.insert( mySuffix.begin(), a->c );
+}
+
+
+////////////////////////////////////////
+
+
+bool
+GlobPattern::matches( const std::string &name ) const
+{
+	if ( myRecursive )
+		return true;
+	if ( myLiteral )
+	{
+#ifdef WIN32
+		if ( name.size() != myPattern.size() )
+			return false;
+		for ( size_t i = 0; i != name.size(); ++i )
+			if ( fold( name[i] ) != fold( myPattern[i] ) )
+				return false;
+		return true;
+#else
+		return name == myPattern;
+#endif
+	}
+
+	const size_t len = name.size();
+	if ( len < myMinLength )
+		return false;
+
+	// most patterns are of the form foo* or *.cpp, so reject on the
+	// literal ends before worrying about the wildcards
+	for ( size_t i = 0; i != myPrefix.size(); ++i )
+		if ( fold( name[i] ) != fold( myPrefix[i] ) )
+			return false;
+	for ( size_t i = 0, off = len - mySuffix.size(); i != mySuffix.size(); ++i )
+		if ( fold( name[off + i] ) != fold( mySuffix[i] ) )
+			return false;
+
+	// a * can always extend to cover more, so only the most recent
+	// one needs remembering to back track to
+	const size_t nAtoms = myAtoms.size();
+	size_t p = myPrefix.size();
+	size_t n = myPrefix.size();
+	size_t starP = std::string::npos;
+	size_t starN = 0;
+	while ( n < len )
+	{
+		if ( p < nAtoms )
+		{
+			const Atom &a = myAtoms[p];
+			if ( a.op == Op::STAR )
+			{
+				starP = p++;
+				starN = n;
+				continue;
+			}
+			if ( matchAtom( a, name[n] ) )
+			{
+				++p;
+				++n;
+				continue;
+			}
+		}
+		if ( starP == std::string::npos )
+			return false;
+		p = starP + 1;
+		n = ++starN;
+	}
+	while ( p < nAtoms && myAtoms[p].op == Op::STAR )
+		++p;
+	return p == nAtoms;
+}
+
+
+////////////////////////////////////////
+
+
+std::vector<std::string>
+GlobPattern::expand( const std::string &pattern )
+{
+	std::vector<std::string> ret;
+	for ( size_t i = 0; i < pattern.size(); ++i )
+	{
+		if ( pattern[i] == '\\' )
+		{
+			++i;
+			continue;
+		}
+		if ( pattern[i] == '[' )
+		{
+			size_t e = classEnd( pattern, i );
+			if ( e != std::string::npos )
+				i = e;
+			continue;
+		}
+		if ( pattern[i] != '{' )
+			continue;
+
+		std::vector<std::string> alts;
+		size_t e = braceEnd( pattern, i, alts );
+		if ( e == std::string::npos )
+			continue;
+
+		std::string pre = pattern.substr( 0, i );
+		std::string post = pattern.substr( e + 1 );
+		for ( const std::string &a: alts )
+		{
+			for ( std::string &x: expand( pre + a + post ) )
+			{
+				bool dup = false;
+				for ( const std::string &r: ret )
+					dup = dup || r == x;
+				if ( ! dup )
+					ret.emplace_back( std::move( x ) );
+			}
+		}
+		return ret;
+	}
+	ret.push_back( pattern );
+	return ret;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+GlobPattern::matchAtom( const Atom &a, char c ) const
+{
+	switch ( a.op )
+	{
+		case Op::CHAR: return fold( a.c ) == fold( c );
+		case Op::ANY: return true;
+		case Op::CLASS: return myClasses[a.cls].test( fold( c ) );
+		case Op::STAR: break;
+	}
+	return false;
+}
+
+
+////////////////////////////////////////
+
+
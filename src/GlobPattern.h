@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <bitset>
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Class GlobPattern matches a single path component against
+/// a shell style wildcard pattern.
+///
+/// Supports ? (any character), * (any run of characters) and
+/// character classes ([abc], [a-z], [!a-z] or [^a-z]). Brace
+/// alternation is handled by expand, which turns a whole pattern into
+/// the list of alternatives before it is split in to components. A
+/// component of just ** is recognized so the caller can match any
+/// number of directories.
+///
+class GlobPattern
+{
+public:
+	GlobPattern( void ) = default;
+	explicit GlobPattern( const std::string &pattern );
+
+	/// true when there are no wildcards, so the pattern can be
+	/// looked up directly instead of compared with every entry
+	inline bool isLiteral( void ) const { return myLiteral; }
+	inline bool isRecursive( void ) const { return myRecursive; }
+	inline const std::string &pattern( void ) const { return myPattern; }
+
+	bool matches( const std::string &name ) const;
+
+	/// expands {a,b} alternation (nested as well) in to the separate
+	/// patterns, in the order written
+	static std::vector<std::string> expand( const std::string &pattern );
+
+private:
+	enum class Op : unsigned char
+	{
+		CHAR,
+		ANY,
+		STAR,
+		CLASS
+	};
+	struct Atom
+	{
+		Op op;
+		char c;
+		size_t cls;
+	};
+
+	bool matchAtom( const Atom &a, char c ) const;
+
+	std::string myPattern;
+	std::vector<Atom> myAtoms;
+	std::vector< std::bitset<256> > myClasses;
+	// literal text before the first wildcard and after the last *,
+	// checked before doing the full match
+	std::string myPrefix;
+	std::string mySuffix;
+	size_t myMinLength = 0;
+	bool myLiteral = true;
+	bool myRecursive = false;
+};
+
+
+////////////////////////////////////////
+
+
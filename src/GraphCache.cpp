@@ -0,0 +1,310 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "GraphCache.h"
+#include "GlobManifest.h"
+#include "TransformSet.h"
+#include "Configuration.h"
+#include "Directory.h"
+#include "Scope.h"
+#include "FileUtil.h"
+#include "CacheData.h"
+#include "Debug.h"
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+
+extern char **environ;
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+static const char theGraphMagic[8] = { 'C', 'T', 'O', 'R', 'G', 'R', 'F', '4' };
+static bool theDisabled = false;
+static bool theLoaded = false;
+static int64_t theKey = 0;
+static std::map< std::string, std::shared_ptr<TransformSet> > theLoadedSets;
+
+// the sets transformed this run, by configuration, as the output
+// directory and the serialized set
+static std::mutex theSetMutex;
+static std::map< std::string, std::pair<std::string, std::string> > theSets;
+static bool theUncacheable = false;
+
+static std::string
+graphFile( void )
+{
+	return File::getCacheDirectory() + File::pathSeparator() + "graph";
+}
+
+
+////////////////////////////////////////
+
+
+// computed before evaluating the construct files, which may change
+// the environment
+static int64_t
+cacheKey( const std::string &cmdline )
+{
+	// the environment can hold anything, so only the hash is kept
+	std::string key = cmdline;
+	key.push_back( '\0' );
+	key.append( Directory::current()->fullpath() );
+
+	std::vector<std::string> env;
+	for ( char **e = environ; e && *e; ++e )
+		env.emplace_back( *e );
+	std::sort( env.begin(), env.end() );
+	for ( const std::string &e: env )
+	{
+		key.push_back( '\0' );
+		key.append( e );
+	}
+
+	// a different constructor may transform differently
+	int64_t sec = -1, nsec = -1;
+#ifdef __linux__
+	File::modTime( "/proc/self/exe", sec, nsec );
+#endif
+	CacheData::put( key, sec );
+	CacheData::put( key, nsec );
+
+	return static_cast<int64_t>( File::hashBytes( key.data(), key.size() ) );
+}
+
+
+
+////////////////////////////////////////
+
+
+static void
+reportUsage( const Configuration &conf, const TransformSet &xform )
+{
+	if ( ! Stats::on() )
+		return;
+
+	FlagList::Usage u;
+	xform.addUsage( u );
+	STATS( "Configuration '" << conf.name() << "': " << u.references() << " variable values in "
+		   << u.lists() << " lists, " << ( u.bytes() / 1024 ) << " KiB ("
+		   << ( ( u.unsharedBytes() - u.bytes() ) / 1024 ) << " KiB saved by sharing)" );
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+namespace GraphCache
+{
+
+
+////////////////////////////////////////
+
+
+void
+disable( void )
+{
+	theDisabled = true;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+load( const std::string &cmdline, const std::string &config )
+{
+	if ( theDisabled || File::getCacheDirectory().empty() )
+		return false;
+	theKey = cacheKey( cmdline );
+
+	std::string data;
+	if ( ! File::readCacheFile( graphFile(), data ) ||
+		 data.compare( 0, sizeof(theGraphMagic), theGraphMagic, sizeof(theGraphMagic) ) != 0 )
+		return false;
+
+	CacheData::Reader rdr( data, sizeof(theGraphMagic) );
+	int64_t key, nConfigs;
+	std::string defConfig;
+	if ( ! rdr.get( key ) || key != theKey ||
+		 ! rdr.get( defConfig ) || ! rdr.get( nConfigs ) || nConfigs <= 0 )
+		return false;
+
+	struct Config
+	{
+		std::string name;
+		std::string system;
+		int64_t skipOnError;
+	};
+	std::vector<Config> configs;
+	for ( int64_t c = 0; c < nConfigs; ++c )
+	{
+		Config cfg;
+		if ( ! rdr.get( cfg.name ) || ! rdr.get( cfg.system ) || ! rdr.get( cfg.skipOnError ) )
+			return false;
+		configs.emplace_back( std::move( cfg ) );
+	}
+
+	int64_t nSets;
+	if ( ! rdr.get( nSets ) )
+		return false;
+	std::map< std::string, std::shared_ptr<TransformSet> > sets;
+	for ( int64_t s = 0; s < nSets; ++s )
+	{
+		std::string name, dir;
+		if ( ! rdr.get( name ) || ! rdr.get( dir ) )
+			return false;
+		auto c = std::find_if( configs.begin(), configs.end(),
+							   [&]( const Config &cfg ) { return cfg.name == name; } );
+		if ( c == configs.end() )
+			return false;
+		std::shared_ptr<TransformSet> x = std::make_shared<TransformSet>( std::make_shared<Directory>( dir ), c->system );
+		if ( ! x->deserialize( rdr ) )
+			return false;
+		sets[name] = x;
+	}
+
+	// every configuration to be emitted has to be there (it may have
+	// been skipped for errors, or another one was asked for last time)
+	for ( const Config &c: configs )
+	{
+		if ( ( config.empty() || c.name == config ) &&
+			 sets.find( c.name ) == sets.end() )
+			return false;
+	}
+	if ( ! config.empty() && sets.find( config ) == sets.end() )
+		return false;
+
+	// checked last as it records the files with the engine
+	if ( ! GlobManifest::restoreInputs( rdr ) )
+		return false;
+
+	Configuration::setDefault( defConfig );
+	for ( const Config &c: configs )
+	{
+		Configuration::defined().emplace_back( c.name );
+		Configuration &cur = Configuration::defined().back();
+		cur.setSystem( c.system );
+		cur.setSkipOnError( c.skipOnError != 0 );
+	}
+	theLoadedSets = std::move( sets );
+	theLoaded = true;
+	VERBOSE( "Using the build graph from the last run" );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+std::shared_ptr<TransformSet>
+transform( const std::shared_ptr<Directory> &dir,
+		   const Configuration &conf )
+{
+	if ( theLoaded )
+	{
+		auto i = theLoadedSets.find( conf.name() );
+		if ( i == theLoadedSets.end() ||
+			 i->second->getOutDir()->fullpath() != dir->fullpath() )
+			throw std::logic_error( "Configuration '" + conf.name() + "' does not match the build graph cache" );
+		reportUsage( conf, *( i->second ) );
+		return i->second;
+	}
+
+	std::shared_ptr<TransformSet> ret = std::make_shared<TransformSet>( dir, conf.getSystem() );
+	Scope::root().transform( *ret, conf );
+	reportUsage( conf, *ret );
+
+	if ( ! theDisabled && ! File::getCacheDirectory().empty() )
+	{
+		std::string out;
+		bool ok = ret->serialize( out );
+		std::lock_guard<std::mutex> lk( theSetMutex );
+		if ( ok )
+			theSets[conf.name()] = std::make_pair( dir->fullpath(), std::move( out ) );
+		else
+			theUncacheable = true;
+	}
+	return ret;
+}
+
+
+////////////////////////////////////////
+
+
+void
+write( void )
+{
+	if ( theDisabled || theLoaded || File::getCacheDirectory().empty() )
+		return;
+
+	std::lock_guard<std::mutex> lk( theSetMutex );
+	if ( theUncacheable )
+	{
+		VERBOSE( "Build graph uses tools built in the tree, not caching it" );
+		::unlink( graphFile().c_str() );
+		return;
+	}
+	if ( theSets.empty() )
+		return;
+
+	const std::vector<Configuration> &configs = Configuration::defined();
+	std::string out( theGraphMagic, sizeof(theGraphMagic) );
+	CacheData::put( out, theKey );
+	CacheData::put( out, Configuration::getDefault().name() );
+	CacheData::put( out, static_cast<int64_t>( configs.size() ) );
+	for ( const Configuration &c: configs )
+	{
+		CacheData::put( out, c.name() );
+		CacheData::put( out, c.getSystem() );
+		CacheData::put( out, static_cast<int64_t>( c.isSkipOnError() ? 1 : 0 ) );
+	}
+
+	CacheData::put( out, static_cast<int64_t>( theSets.size() ) );
+	for ( const auto &s: theSets )
+	{
+		CacheData::put( out, s.first );
+		CacheData::put( out, s.second.first );
+		out.append( s.second.second );
+	}
+
+	GlobManifest::putInputs( out );
+	File::writeCacheFile( graphFile(), out );
+}
+
+
+////////////////////////////////////////
+
+
+} // namespace GraphCache
+
@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+
+class Directory;
+class Configuration;
+class TransformSet;
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Keeps the transformed build graph of each configuration in
+/// the cache directory.
+///
+/// The graph depends on the same files, globs and external inputs
+/// (.pc files, package and program search directories) recorded for
+/// GlobManifest, along with the command line (less the generator),
+/// the environment and the constructor binary itself. When none of
+/// those changed, the configurations and their transformed sets are
+/// read back instead of evaluating the construct files and
+/// transforming the tree, so switching generators or re-running with
+/// the same arguments only has to emit the build files.
+/// --no-graph-cache evaluates the tree regardless.
+///
+namespace GraphCache
+{
+
+/// disables reading (and writing) the cache for this run
+void disable( void );
+
+/// if the cache for the command line is current (and has each
+/// configuration to emit), restores the configurations and the files
+/// visited and returns true. config is the configuration requested,
+/// if any
+bool load( const std::string &cmdline, const std::string &config );
+
+/// the transformed set for the configuration, from the cache when
+/// it was loaded, otherwise by transforming the evaluated tree (and
+/// keeping the result for write)
+std::shared_ptr<TransformSet> transform( const std::shared_ptr<Directory> &dir,
+										 const Configuration &conf );
+
+/// writes the transformed sets of this run (for the command line
+/// given to load), unless they came from the cache
+void write( void );
+
+} // namespace GraphCache
+
@@ -28,6 +28,7 @@
 #include "Debug.h"
 #include "TransformSet.h"
 #include <iostream>
+#include <atomic>
 
 
 ////////////////////////////////////////
@@ -35,7 +36,7 @@
 
 namespace {
 
-static Item::ID theLastID = 1;
+static std::atomic<Item::ID> theLastID( 1 );
 
 } // empty namespace
 
@@ -54,7 +55,7 @@ Item::Item( const std::string &name )
 
 
 Item::Item( std::string &&name )
-		: myID( theLastID++ ), myName( std::move( name ) ),
+		: myID( theLastID++ ), myName( name ),
 		  myDirectory( Directory::current() )
 {
 }
@@ -74,7 +75,7 @@ Item::~Item( void )
 const std::string &
 Item::getName( void ) const 
 {
-	return myName;
+	return myName.str();
 }
 
 
@@ -150,7 +151,7 @@ Item::copyDependenciesToBuild( TransformSet &xform ) const
 		{
 			std::shared_ptr<BuildItem> d = xform.getTransform( dep.first->getID() );
 			if ( d )
-				ret->addDependency( dep.second, d );
+				ret->addDependency( dep.second.type, d );
 		}
 	}
 }
@@ -31,12 +31,21 @@
 #include "Variable.h"
 #include "Dependency.h"
 #include "Directory.h"
+#include "Symbol.h"
 
 class Item;
 class TransformSet;
 class BuildItem;
 class Tool;
 
+// items (i.e. package configs) are shared by the subprojects and
+// configurations processed in parallel
+template <>
+struct DependencyTraits<Item>
+{
+	static const bool sharedGraph = true;
+};
+
 /// @brief base class for everything else in the system
 ///
 /// In a build system, there are either targets, sources,
@@ -97,7 +106,7 @@ protected:
 
 private:
 	ID myID;
-	std::string myName;
+	Symbol myName;
 	std::string myPseudoName;
 	std::shared_ptr<Directory> myDirectory;
 
@@ -28,6 +28,7 @@
 #include "LuaValue.h"
 #include "ScopeGuard.h"
 #include "LuaItemExt.h"
+#include "LuaExtensions.h"
 #include "Scope.h"
 #include "Library.h"
 #include "Executable.h"
@@ -43,10 +44,10 @@
 namespace
 {
 
-static std::shared_ptr<Library> theCurLib;
-static std::map<std::string, ItemPtr> theDefinedLibs;
-static std::shared_ptr<Executable> theCurExe;
-static std::map<std::string, ItemPtr> theDefinedExes;
+static thread_local std::shared_ptr<Library> theCurLib;
+static thread_local std::map<std::string, ItemPtr> theDefinedLibs;
+static thread_local std::shared_ptr<Executable> theCurExe;
+static thread_local std::map<std::string, ItemPtr> theDefinedExes;
 
 
 ////////////////////////////////////////
@@ -339,6 +340,12 @@ recurseAndAddLibs( const std::shared_ptr<Set> &item,
 		const char *n = lua_tolstring( L, i, &len );
 		std::string lname( n, len );
 		auto l = theDefinedLibs.find( lname );
+		if ( l == theDefinedLibs.end() )
+		{
+			// may come from a subproject still being evaluated
+			Lua::finishSubProjects();
+			l = theDefinedLibs.find( lname );
+		}
 		if ( l == theDefinedLibs.end() )
 			throw std::runtime_error( "Unable to find library by name '" + lname + "', make sure it is declared first" );
 		item->addItem( l->second );
@@ -710,6 +717,26 @@ void clearCompileContext( void )
 ////////////////////////////////////////
 
 
+std::map<std::string, ItemPtr> &
+definedLibraries( void )
+{
+	return theDefinedLibs;
+}
+
+
+////////////////////////////////////////
+
+
+std::map<std::string, ItemPtr> &
+definedExecutables( void )
+{
+	return theDefinedExes;
+}
+
+
+////////////////////////////////////////
+
+
 void registerCompileExt( void )
 {
 	Engine &eng = Engine::singleton();
@@ -24,6 +24,8 @@
 
 #include "Compile.h"
 #include "LuaItemExt.h"
+#include <map>
+#include <string>
 
 
 ////////////////////////////////////////
@@ -33,6 +35,11 @@ namespace Lua
 {
 
 void clearCompileContext( void );
+
+// the libraries and executables defined so far, by name. Like the
+// rest of the compile context, these belong to the evaluating thread
+std::map<std::string, ItemPtr> &definedLibraries( void );
+std::map<std::string, ItemPtr> &definedExecutables( void );
 void registerCompileExt( void );
 
 } // namespace Lua
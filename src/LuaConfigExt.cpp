@@ -44,6 +44,8 @@ luaBuildConfiguration( lua_State *L )
 	if ( lua_gettop( L ) != 1 || ! lua_isstring( L, 1 ) )
 		throw std::runtime_error( "Expected 1 argument - a string - to configuration" );
 	std::string nm = Lua::Parm<std::string>::get( L, 1, 1 );
+	if ( Lua::Engine::isThreadEngine() )
+		throw std::runtime_error( "Configuration '" + nm + "' can not be defined in a subproject evaluated in parallel" );
 
 	// hrm, the constructor will call Scope::current but that could be
 	// a previous config which we don't want to inherit from
@@ -63,6 +65,8 @@ luaDefaultConfiguration( lua_State *L )
 		throw std::runtime_error( "Expected 1 argument - a string - to default_configuration" );
 
 	const char *s = lua_tolstring( L, 1, NULL );
+	if ( Lua::Engine::isThreadEngine() )
+		throw std::runtime_error( "Default configuration can not be set in a subproject evaluated in parallel" );
 	DEBUG( "luaDefaultConfiguration " << s );
 	bool found = false;
 	for ( const Configuration &c: Configuration::defined() )
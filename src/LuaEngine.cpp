@@ -32,13 +32,19 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <system_error>
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <iomanip>
+#include <thread>
 #include <vector>
+#include <algorithm>
 
 namespace
 {
@@ -141,6 +147,9 @@ public:
 		return myBuf.data();
 	}
 
+	const char *data( void ) const { return myBuf.data(); }
+	size_t size( void ) const { return myBuf.size(); }
+
 private:
 	std::vector<char> myBuf;
 	mutable size_t myLeft = 0;
@@ -157,6 +166,56 @@ fileReader( lua_State *, void *ud, size_t *sz )
 ////////////////////////////////////////
 
 
+// compiled chunks are stored in the cache directory as this
+// header, the key (source path and chunk name), then the output
+// of lua_dump
+struct BytecodeHeader
+{
+	char magic[8];
+	uint64_t size;
+	int64_t mtimeSec;
+	int64_t mtimeNSec;
+	uint64_t hash;
+	uint64_t keyLen;
+};
+
+static const char theBytecodeMagic[8] = { 'C', 'T', 'O', 'R', 'L', 'B', 'C', '1' };
+static thread_local Lua::Engine *theThreadEngine = nullptr;
+
+void
+getModTime( const struct stat &sb, int64_t &sec, int64_t &nsec )
+{
+#ifdef __APPLE__
+	sec = static_cast<int64_t>( sb.st_mtimespec.tv_sec );
+	nsec = static_cast<int64_t>( sb.st_mtimespec.tv_nsec );
+#else
+	sec = static_cast<int64_t>( sb.st_mtim.tv_sec );
+	nsec = static_cast<int64_t>( sb.st_mtim.tv_nsec );
+#endif
+}
+
+std::string
+bytecodeCacheFile( const std::string &key )
+{
+	std::stringstream fn;
+	fn << File::getCacheDirectory() << File::pathSeparator() << "bytecode"
+	   << File::pathSeparator() << std::hex << std::setw( 16 )
+	   << std::setfill( '0' ) << File::hashBytes( key.data(), key.size() ) << ".luac";
+	return fn.str();
+}
+
+int
+dumpWriter( lua_State *, const void *p, size_t sz, void *ud )
+{
+	std::string *s = reinterpret_cast<std::string *>( ud );
+	s->append( reinterpret_cast<const char *>( p ), sz );
+	return 0;
+}
+
+
+////////////////////////////////////////
+
+
 static int
 luaAddModulePath( lua_State *L )
 {
@@ -381,8 +440,7 @@ Engine::loadModule( std::string p )
 
 	std::string tmpname = "@";
 	tmpname.append( p );
-	LuaFile f( luaFile.c_str() );
-	throwIfError( L, lua_load( L, &fileReader, &f, tmpname.c_str(), NULL ), p.c_str() );
+	loadFile( luaFile, tmpname, p.c_str() );
 
 	// add filename as argument to module
 	lua_pushstring( L, luaFile.c_str() );
@@ -539,8 +597,7 @@ Engine::runFile( const char *file, int envPos )
 
 	std::string tmpname = "@";
 	tmpname.append( file );
-	LuaFile f( file );
-	throwIfError( L, lua_load( L, &fileReader, &f, tmpname.c_str(), NULL ), file );
+	loadFile( fn, tmpname, file );
 
 	int funcPos = lua_gettop( L );
 
@@ -587,15 +644,110 @@ Engine::runFile( const char *file, int envPos )
 
 
 void
-Engine::addVisitedFile( const std::string &f )
+Engine::setBytecodeCache( bool enable )
 {
-	for ( const auto &i: myVisitedPaths )
+	myUseBytecodeCache = enable;
+}
+
+
+////////////////////////////////////////
+
+
+void
+Engine::loadFile( const std::string &file, const std::string &chunkName,
+				  const char *errName )
+{
+	std::string key;
+	std::string cacheFile;
+	struct stat sb;
+	if ( myUseBytecodeCache && ! File::getCacheDirectory().empty() &&
+		 ::stat( file.c_str(), &sb ) == 0 )
 	{
-		if ( i == f )
-			return;
+		key = file;
+		key.push_back( '\0' );
+		key.append( chunkName );
+		cacheFile = bytecodeCacheFile( key );
+	}
+
+	std::unique_ptr<LuaFile> src;
+	std::string cached;
+	if ( ! cacheFile.empty() && File::readCacheFile( cacheFile, cached ) &&
+		 cached.size() > sizeof(BytecodeHeader) )
+	{
+		BytecodeHeader hdr;
+		memcpy( &hdr, cached.data(), sizeof(BytecodeHeader) );
+		size_t chunkStart = sizeof(BytecodeHeader) + key.size();
+		if ( memcmp( hdr.magic, theBytecodeMagic, sizeof(theBytecodeMagic) ) == 0 &&
+			 hdr.keyLen == key.size() && cached.size() > chunkStart &&
+			 cached.compare( sizeof(BytecodeHeader), key.size(), key ) == 0 &&
+			 hdr.size == static_cast<uint64_t>( sb.st_size ) )
+		{
+			int64_t mSec, mNSec;
+			getModTime( sb, mSec, mNSec );
+			bool current = ( hdr.mtimeSec == mSec && hdr.mtimeNSec == mNSec );
+			if ( ! current )
+			{
+				// the file was touched (i.e. a checkout), but may not
+				// have changed, check the contents before giving up
+				src.reset( new LuaFile( file.c_str() ) );
+				if ( File::hashBytes( src->data(), src->size() ) == hdr.hash )
+				{
+					current = true;
+					hdr.mtimeSec = mSec;
+					hdr.mtimeNSec = mNSec;
+					memcpy( &cached[0], &hdr, sizeof(BytecodeHeader) );
+					File::writeCacheFile( cacheFile, cached );
+				}
+			}
+
+			if ( current )
+			{
+				if ( luaL_loadbufferx( L, cached.data() + chunkStart,
+									   cached.size() - chunkStart,
+									   chunkName.c_str(), "b" ) == LUA_OK )
+				{
+					DEBUG( "loaded cached bytecode for " << file );
+					return;
+				}
+				// built with a different version of lua or otherwise
+				// corrupt, just recompile
+				lua_pop( L, 1 );
+			}
+		}
 	}
-	myVisitedPaths.push_back( f );
-	std::sort( myVisitedPaths.begin(), myVisitedPaths.end() );
+
+	if ( ! src )
+		src.reset( new LuaFile( file.c_str() ) );
+	throwIfError( L, lua_load( L, &fileReader, src.get(), chunkName.c_str(), NULL ), errName );
+
+	if ( cacheFile.empty() )
+		return;
+
+	BytecodeHeader hdr;
+	memcpy( hdr.magic, theBytecodeMagic, sizeof(theBytecodeMagic) );
+	hdr.size = static_cast<uint64_t>( src->size() );
+	getModTime( sb, hdr.mtimeSec, hdr.mtimeNSec );
+	hdr.hash = File::hashBytes( src->data(), src->size() );
+	hdr.keyLen = key.size();
+
+	std::string out( reinterpret_cast<const char *>( &hdr ), sizeof(BytecodeHeader) );
+	out.append( key );
+	if ( lua_dump( L, &dumpWriter, &out, 0 ) == 0 )
+		File::writeCacheFile( cacheFile, out );
+}
+
+
+////////////////////////////////////////
+
+
+void
+Engine::addVisitedFile( const std::string &f )
+{
+	// kept sorted, a recursive glob can add a lot of directories
+	auto i = std::lower_bound( myVisitedPaths.begin(), myVisitedPaths.end(), f );
+	if ( i != myVisitedPaths.end() && *i == f )
+		return;
+	myVisitedPaths.insert( i, f );
 }
 
 
@@ -612,6 +764,31 @@ Engine::visitedFiles( void )
 ////////////////////////////////////////
 
 
+void
+Engine::addGlob( GlobRecord &&g )
+{
+	for ( const auto &i: myGlobs )
+	{
+		if ( i.root == g.root && i.pattern == g.pattern )
+			return;
+	}
+	myGlobs.emplace_back( std::move( g ) );
+}
+
+
+////////////////////////////////////////
+
+
+const std::vector<Engine::GlobRecord> &
+Engine::globs( void )
+{
+	return myGlobs;
+}
+
+
+////////////////////////////////////////
+
+
 const char *
 Engine::getError( void )
 {
@@ -628,6 +805,9 @@ Engine::getError( void )
 Engine &
 Engine::singleton( void )
 {
+	if ( theThreadEngine )
+		return *theThreadEngine;
+
 	static Engine theEng;
 	return theEng;
 }
@@ -636,6 +816,38 @@ Engine::singleton( void )
 ////////////////////////////////////////
 
 
+bool
+Engine::isThreadEngine( void )
+{
+	return theThreadEngine != nullptr;
+}
+
+
+////////////////////////////////////////
+
+
+Engine::ThreadEngine::ThreadEngine( void )
+		: myEngine( new Engine ), myPrevious( theThreadEngine )
+{
+	// the options are only set on the main engine
+	myEngine->myUseBytecodeCache = singleton().myUseBytecodeCache;
+	theThreadEngine = myEngine;
+}
+
+
+////////////////////////////////////////
+
+
+Engine::ThreadEngine::~ThreadEngine( void )
+{
+	theThreadEngine = myPrevious;
+	delete myEngine;
+}
+
+
+////////////////////////////////////////
+
+
 void
 Engine::copyTable( int tablePos, int destPos )
 {
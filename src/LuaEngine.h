@@ -92,6 +92,7 @@ public:
 
 	void resetModulePath( void );
 	void addModulePath( std::string p );
+	inline const std::vector<std::string> &modulePath( void ) const { return myModulePath; }
 	int loadModule( std::string p );
 
 	void pushLibrary( const char *name );
@@ -110,13 +111,58 @@ public:
 	void addVisitedFile( const std::string &f );
 	const std::vector<std::string> &visitedFiles( void );
 
+	// a file.glob evaluated while processing, kept so regeneration
+	// can first check whether any of the matches changed
+	struct GlobRecord
+	{
+		std::string root;
+		std::string pattern;
+		std::vector<std::string> matches;
+		std::vector<std::string> searched;
+	};
+	void addGlob( GlobRecord &&g );
+	const std::vector<GlobRecord> &globs( void );
+
+	// when enabled (the default), the compiled form of each file
+	// loaded is stored in the cache directory and re-used on
+	// subsequent runs when the source has not changed
+	void setBytecodeCache( bool enable );
+
 	inline lua_State *state( void ) { return L; }
 	const char *getError( void );
 
 	static Engine &singleton( void );
 
+	///
+	/// @brief Class ThreadEngine provides a separate engine (and
+	/// lua_State) for the creating thread.
+	///
+	/// While it exists, singleton() returns it for that thread, such
+	/// that independent trees (i.e. subprojects) can be evaluated in
+	/// parallel. The extensions must be registered for it.
+	///
+	class ThreadEngine
+	{
+	public:
+		ThreadEngine( void );
+		~ThreadEngine( void );
+		ThreadEngine( const ThreadEngine & ) = delete;
+		ThreadEngine &operator=( const ThreadEngine & ) = delete;
+
+		inline Engine &engine( void ) { return *myEngine; }
+
+	private:
+		Engine *myEngine;
+		Engine *myPrevious;
+	};
+
+	// true if the calling thread is using a ThreadEngine
+	static bool isThreadEngine( void );
+
 private:
 	void copyTable( int tablePos, int destTablePos );
+	void loadFile( const std::string &file, const std::string &chunkName,
+				   const char *errName );
 
 	static int errorCB( lua_State *L );
 	static int dispatchFunc( lua_State *L );
@@ -132,9 +178,11 @@ private:
 
 	std::vector<std::string> myModulePath;
 	std::vector<std::string> myVisitedPaths;
+	std::vector<GlobRecord> myGlobs;
 
 	lua_State *L;
 	int myErrFunc;
+	bool myUseBytecodeCache = true;
 };
 
 } // namespace Lua
@@ -54,6 +54,7 @@
 #include "Configuration.h"
 #include "PackageConfig.h"
 #include "Version.h"
+#include "ThreadPool.h"
 
 #include <map>
 #include <mutex>
@@ -82,6 +83,62 @@ static std::vector<std::string> theSubDirFiles;
 ////////////////////////////////////////
 
 
+struct PendingSubProject
+{
+	std::string file;
+	std::shared_ptr<Directory> dir;
+	std::shared_ptr<Scope> scope;
+	std::vector<std::string> modulePath;
+	std::map<std::string, ItemPtr> libs;
+	std::map<std::string, ItemPtr> exes;
+	std::vector<std::string> visited;
+	std::vector<Lua::Engine::GlobRecord> globs;
+};
+
+static bool theParallelSubProjects = false;
+static std::vector< std::shared_ptr<PendingSubProject> > thePendingSubProjects;
+static std::unique_ptr<TaskGroup> theSubProjectTasks;
+
+static void
+evalSubProject( PendingSubProject &sp )
+{
+	Lua::Engine::ThreadEngine te;
+	Lua::Engine &eng = te.engine();
+	Lua::registerExtensions();
+	for ( const std::string &p: sp.modulePath )
+		eng.addModulePath( p );
+
+	// the subproject sees what was defined by the time it was
+	// started, and brings back what it defines when finished
+	Lua::definedLibraries().swap( sp.libs );
+	Lua::definedExecutables().swap( sp.exes );
+	ON_EXIT{
+		Lua::definedLibraries().swap( sp.libs );
+		Lua::definedExecutables().swap( sp.exes );
+	};
+
+	Directory::pushd( sp.dir );
+	ON_EXIT{ Directory::popd(); };
+
+	Scope::pushScope( sp.scope );
+	ON_EXIT{ Scope::popScope( false ); };
+
+	Lua::clearToolset();
+	Lua::clearCompileContext();
+
+	eng.runFile( sp.file.c_str() );
+
+	Lua::clearToolset();
+	Lua::clearCompileContext();
+
+	sp.visited = eng.visitedFiles();
+	sp.globs = eng.globs();
+}
+
+
+////////////////////////////////////////
+
+
 inline constexpr const char *buildFileName( void )
 {
 	return "construct";
@@ -170,6 +227,40 @@ luaSubProject( lua_State *L )
 	std::string file = Lua::Parm<std::string>::get( L, N, 1 );
 	DEBUG( "luaSubDir " << file );
 	std::shared_ptr<Directory> curDir = Directory::current();
+
+	if ( theParallelSubProjects && ! Lua::Engine::isThreadEngine() )
+	{
+		std::shared_ptr<PendingSubProject> sp = std::make_shared<PendingSubProject>();
+		if ( File::isAbsolute( file.c_str() ) )
+			sp->dir = std::make_shared<Directory>( file );
+		else
+		{
+			std::string tmp;
+			if ( ! curDir->exists( tmp, file ) )
+				throw std::runtime_error( "Sub Directory '" + file + "' does not exist in " + curDir->fullpath() );
+			sp->dir = std::make_shared<Directory>( *curDir );
+			sp->dir->cd( file );
+		}
+		if ( ! sp->dir->exists( sp->file, buildFileName() ) )
+			throw std::runtime_error( "Unable to find a '" + std::string( buildFileName() ) + "' in " + sp->dir->fullpath() );
+
+		Lua::clearToolset();
+		Lua::clearCompileContext();
+
+		// the scope is created here so the tree is in the same order
+		// as a serial evaluation
+		sp->scope = Scope::current().newSubScope( false );
+		sp->modulePath = Lua::Engine::singleton().modulePath();
+		sp->libs = Lua::definedLibraries();
+		sp->exes = Lua::definedExecutables();
+
+		if ( ! theSubProjectTasks )
+			theSubProjectTasks.reset( new TaskGroup );
+		thePendingSubProjects.push_back( sp );
+		theSubProjectTasks->run( [sp]() { evalSubProject( *sp ); } );
+		return 0;
+	}
+
 	if ( File::isAbsolute( file.c_str() ) )
 	{
 		std::shared_ptr<Directory> nRoot = std::make_shared<Directory>( file );
@@ -239,6 +330,57 @@ registerExtensions( void )
 ////////////////////////////////////////
 
 
+void
+setParallelSubProjects( bool p )
+{
+	theParallelSubProjects = p;
+}
+
+
+////////////////////////////////////////
+
+
+void
+finishSubProjects( void )
+{
+	if ( ! theSubProjectTasks || Lua::Engine::isThreadEngine() )
+		return;
+
+	// the pending entries have to be merged regardless of errors, but
+	// the tasks themselves use the caller's thread local state, so
+	// don't help run them
+	ON_EXIT{ thePendingSubProjects.clear(); };
+	theSubProjectTasks->wait( false );
+
+	for ( auto &sp: thePendingSubProjects )
+	{
+		for ( auto &l: sp->libs )
+		{
+			auto i = definedLibraries().find( l.first );
+			if ( i == definedLibraries().end() )
+				definedLibraries()[l.first] = l.second;
+			else if ( i->second != l.second )
+				throw std::logic_error( "Multiple libraries by the name '" + l.first + "' defined" );
+		}
+		for ( auto &e: sp->exes )
+		{
+			auto i = definedExecutables().find( e.first );
+			if ( i == definedExecutables().end() )
+				definedExecutables()[e.first] = e.second;
+			else if ( i->second != e.second )
+				throw std::logic_error( "Multiple executables by the name '" + e.first + "' defined" );
+		}
+		for ( auto &v: sp->visited )
+			Engine::singleton().addVisitedFile( v );
+		for ( auto &g: sp->globs )
+			Engine::singleton().addGlob( std::move( g ) );
+	}
+}
+
+
+////////////////////////////////////////
+
+
 void
 startParsing( const std::string &dir )
 {
@@ -255,6 +397,7 @@ startParsing( const std::string &dir )
 	if ( curDir->exists( firstFile, buildFileName() ) )
 	{
 		Lua::Engine::singleton().runFile( firstFile.c_str() );
+		finishSubProjects();
 	}
 	else
 	{
@@ -37,6 +37,15 @@ void registerExtensions( void );
 
 void startParsing( const std::string &dir );
 
+// When enabled, subprojects are evaluated in parallel, each in a
+// separate lua_State. Since they share no lua globals, subproject
+// returns nil in this mode, and they may only reference libraries
+// defined before they were started. finishSubProjects waits for
+// them, merging in the libraries they define, and is called at the
+// end of parsing or when looking up a library not yet defined
+void setParallelSubProjects( bool p );
+void finishSubProjects( void );
+
 } // namespace src
 
 
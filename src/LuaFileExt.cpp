@@ -84,7 +84,7 @@ pathVarLookup( const std::string &name )
 
 	if ( name == "PATH" )
 	{
-		static std::string curPath;
+		static thread_local std::string curPath;
 		const std::vector<std::string> &path = File::getPath();
 		curPath.clear();
 		for ( const std::string &p: path )
@@ -155,47 +155,38 @@ luaFindFile( lua_State *L )
 // a pattern with sub-directories in it, always in unix notation,
 // and shell globbing rules more than just a standard posix regex,
 // so a pattern of {foo,bar}/*.h would search for *.h in sub-dirs
-// foo and bar.
+// foo and bar, and src/**/*.cpp for any .cpp below src.
 static void globDir( std::shared_ptr<CompileSet> &ret,
 					 const std::string &pattern )
 {
 	auto curD = Directory::current();
 
-	// trigger constructor to re-run if one of
-	// the searched directories changes
-	const std::string &fp = curD->fullpath();
-
-	// NB: NOT using the pathSeparator here
 	/// @todo { Document the file glob and separator for subdirs }
-	std::string::size_type pSep = pattern.find_first_of( '/' );
+	std::vector<std::string> searched;
+	std::vector<std::string> files = File::globFiles( curD->fullpath(), pattern, searched );
 
-	if ( pSep != std::string::npos )
+	// trigger constructor to re-run if one of
+	// the searched directories changes
+	for ( const std::string &d: searched )
+		Lua::Engine::singleton().addVisitedFile( d );
+	Lua::Engine::singleton().addGlob( { curD->fullpath(), pattern, files, searched } );
+
+	// can't use the utility string-based addItem since the file
+	// might be in a sub-dir of the directory the compile set is set
+	// to in which case the utility addItem fails because it doesn't
+	// exist
+	for ( std::string &f: files )
 	{
-		std::string curMatch = pattern.substr( 0, pSep );
-		std::string subMatch = pattern.substr( pSep + 1 );
-
-		std::string pat = File::globToRegex( curMatch );
-		if ( pat != curMatch )
-			Lua::Engine::singleton().addVisitedFile( fp );
-
-		std::vector<std::string> subs = File::globRegex( fp, pat );
-		for ( const std::string &s: subs )
+		std::string::size_type sep = f.find_last_of( File::pathSeparator() );
+		if ( sep == std::string::npos )
 		{
-			Directory::pushd( s );
-			ON_EXIT{ Directory::popd(); };
-			globDir( ret, subMatch );
+			ret->addItem( std::make_shared<Item>( std::move( f ) ) );
+			continue;
 		}
-	}
-	else
-	{
-		Lua::Engine::singleton().addVisitedFile( fp );
 
-		// can't use the utility string-based addItem since
-		// we might be recursed to a sub-dir of the directory the
-		// compile set is set to in which case the utility addItem
-		// fails because it doesn't exist
-		for ( std::string &f: File::glob( fp, pattern ) )
-			ret->addItem( std::make_shared<Item>( std::move( f ) ) );
+		Directory::pushd( f.substr( 0, sep ) );
+		ON_EXIT{ Directory::popd(); };
+		ret->addItem( std::make_shared<Item>( f.substr( sep + 1 ) ) );
 	}
 }
 
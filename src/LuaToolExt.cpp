@@ -28,6 +28,7 @@
 #include "Debug.h"
 #include "Directory.h"
 #include "Scope.h"
+#include "DefaultTools.h"
 #include "LuaExtensions.h"
 
 #include <stdexcept>
@@ -41,7 +42,7 @@
 namespace
 {
 
-static std::shared_ptr<Toolset> theCurToolset;
+static thread_local std::shared_ptr<Toolset> theCurToolset;
 static std::vector<std::string> theToolModulePath;
 
 
@@ -177,6 +178,10 @@ luaAddToolOption( const std::string &t, const std::string &g,
 		if ( tool->getName() == t )
 		{
 			found = true;
+			// the default tools are shared by every scope, so give
+			// this scope its own copy to change
+			if ( DefaultTools::isShared( tool.get() ) )
+				Scope::current().addTool( std::make_shared<Tool>( *tool ) );
 			tool->addOption( g, name, cmd );
 		}
 	}
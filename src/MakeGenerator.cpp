@@ -24,10 +24,11 @@
 #include "FileUtil.h"
 #include "TransformSet.h"
 #include "LuaEngine.h"
-#include "Scope.h"
 #include "Debug.h"
 #include "StrUtil.h"
 #include "Configuration.h"
+#include "GlobManifest.h"
+#include "GraphCache.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -50,8 +51,9 @@ escape_path( const std::string &fn )
 }
 
 static void
-addOutputList( std::ostream &os, const std::shared_ptr<BuildItem> &bi, bool addFirstSpace = true )
+addOutputList( std::ostream &os, const BuildGraph &g, BuildGraph::NodeID n, bool addFirstSpace = true )
 {
+	const std::shared_ptr<BuildItem> &bi = g.item( n );
 	auto outd = bi->getOutDir();
 	bool notFirst = addFirstSpace;
 	if ( outd )
@@ -78,11 +80,9 @@ addOutputList( std::ostream &os, const std::shared_ptr<BuildItem> &bi, bool addF
 
 	if ( ! bi->getTool() )
 	{
-		std::vector< std::shared_ptr<BuildItem> > deps =
-			bi->extractDependencies( DependencyType::EXPLICIT );
-		for ( auto &d: deps )
+		for ( BuildGraph::NodeID d: g.dependencies( n, DependencyType::EXPLICIT ) )
 		{
-			addOutputList( os, d, notFirst );
+			addOutputList( os, g, d, notFirst );
 			notFirst = true;
 		}
 	}
@@ -108,9 +108,18 @@ addOutputDirMake( std::ostream &os, const std::shared_ptr<BuildItem> &bi )
 static void
 emitTargets( std::ostream &os, std::vector<std::string> &defTargs, std::vector<std::string> &depFiles, const TransformSet &x )
 {
-	std::set< std::shared_ptr<Tool> > toolsInPlay;
-	for ( const std::shared_ptr<BuildItem> &bi: x.getBuildItems() )
-		toolsInPlay.insert( bi->getTool() );
+	// in the order the items first use them, so the output doesn't
+	// depend on where the tools were allocated (i.e. when they came
+	// from the graph cache)
+	const BuildGraph &g = x.getGraph();
+	std::vector< std::shared_ptr<Tool> > toolsInPlay;
+	std::set<const Tool *> seenTools;
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
+	{
+		const std::shared_ptr<Tool> &t = g.item( n )->getTool();
+		if ( t && seenTools.insert( t.get() ).second )
+			toolsInPlay.push_back( t );
+	}
 
 	std::map<std::shared_ptr<Tool>, Rule> rules;
 	for ( const std::shared_ptr<Tool> &t: toolsInPlay )
@@ -126,8 +135,9 @@ emitTargets( std::ostream &os, std::vector<std::string> &defTargs, std::vector<s
 	}
 
 	std::set<std::string> outDirs;
-	for ( const std::shared_ptr<BuildItem> &bi: x.getBuildItems() )
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
 	{
+		const std::shared_ptr<BuildItem> &bi = g.item( n );
 		auto outd = bi->getOutDir();
 
 		if ( outd )
@@ -147,8 +157,9 @@ emitTargets( std::ostream &os, std::vector<std::string> &defTargs, std::vector<s
 		}
 	}
 	
-	for ( const std::shared_ptr<BuildItem> &bi: x.getBuildItems() )
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
 	{
+		const std::shared_ptr<BuildItem> &bi = g.item( n );
 		auto t = bi->getTool();
 		if ( t )
 		{
@@ -161,7 +172,7 @@ emitTargets( std::ostream &os, std::vector<std::string> &defTargs, std::vector<s
 			for ( auto &bv: bivars )
 			{
 				std::string outv = bv.second.prepended_value( t->getCommandPrefix( bv.first ), x.getSystem() );
-				addOutputList( os, bi, false );
+				addOutputList( os, g, n, false );
 				os << ": override " << bv.first << ":=" << outv << '\n';
 			}
 
@@ -171,7 +182,7 @@ emitTargets( std::ostream &os, std::vector<std::string> &defTargs, std::vector<s
 				if ( bi->getOutputs().size() != 1 )
 					throw std::runtime_error( "Sorry Makefile generator does not support dependency files and multiple outputs" );
 				std::stringstream depfilebuf;
-				addOutputList( depfilebuf, bi, false );
+				addOutputList( depfilebuf, g, n, false );
 				std::map<std::string, std::string> outV;
 				outV["out"] = depfilebuf.str();
 				std::string dfn = dFile;
@@ -179,72 +190,63 @@ emitTargets( std::ostream &os, std::vector<std::string> &defTargs, std::vector<s
 				depFiles.push_back( dfn );
 			}
 
-			addOutputList( os, bi, false );
+			addOutputList( os, g, n, false );
 			os << ": override out := ";
-			addOutputList( os, bi, false );
+			addOutputList( os, g, n, false );
 			os << "\n";
 
-			std::vector< std::shared_ptr<BuildItem> > deps =
-				bi->extractDependencies( DependencyType::EXPLICIT );
-			addOutputList( os, bi, false );
+			BuildGraph::EdgeRange deps = g.dependencies( n, DependencyType::EXPLICIT );
+			addOutputList( os, g, n, false );
 			os << ": override in := ";
 			bool notFirst = false;
 
 			if ( bi->useName() )
 			{
 				os << escape_path( bi->getDir()->makefilename( bi->getName() ) );
-				for ( auto &d: deps )
-					addOutputList( os, d, true );
+				for ( BuildGraph::NodeID d: deps )
+					addOutputList( os, g, d, true );
 				notFirst = true;
 			}
 			else
 			{
-				for ( auto &d: deps )
+				for ( BuildGraph::NodeID d: deps )
 				{
-					addOutputList( os, d, notFirst );
+					addOutputList( os, g, d, notFirst );
 					notFirst = true;
 				}
 			}
 			os << "\n";
 
-			addOutputList( os, bi, false );
+			addOutputList( os, g, n, false );
 			os << ": ";
 			notFirst = false;
 			if ( bi->useName() )
 			{
 				os << escape_path( bi->getDir()->makefilename( bi->getName() ) );
-				for ( auto &d: deps )
-					addOutputList( os, d, true );
+				for ( BuildGraph::NodeID d: deps )
+					addOutputList( os, g, d, true );
 				notFirst = true;
 			}
 			else
 			{
-				for ( auto &d: deps )
+				for ( BuildGraph::NodeID d: deps )
 				{
-					addOutputList( os, d, notFirst );
+					addOutputList( os, g, d, notFirst );
 					notFirst = true;
 				}
 			}
 			
-			deps = bi->extractDependencies( DependencyType::IMPLICIT );
-			if ( ! deps.empty() )
+			for ( BuildGraph::NodeID d: g.dependencies( n, DependencyType::IMPLICIT ) )
 			{
-				for ( auto &d: deps )
-				{
-					addOutputList( os, d, notFirst );
-					notFirst = true;
-				}
+				addOutputList( os, g, d, notFirst );
+				notFirst = true;
 			}
 
 			os << " |";
 			addOutputDirMake( os, bi );
 
-			deps = bi->extractDependencies( DependencyType::ORDER );
-			if ( ! deps.empty() )
-			{
-				for ( auto &d: deps )
-					addOutputList( os, d, true );
-			}
+			for ( BuildGraph::NodeID d: g.dependencies( n, DependencyType::ORDER ) )
+				addOutputList( os, g, d, true );
 
 			os << "\n\t@echo \"" << r.getDescription() << "\"";
 			os << "\n\t@" << r.getCommand() << "\n";
@@ -312,6 +314,7 @@ emitScope( std::ostream &os,
 		   << "\t@$(MAKE) -f " << sfn << "\n";
 
 		std::ofstream ssf( outD.makefilename( sfn ) );
+		File::invalidateStatCache( outD.makefilename( sfn ) );
 		ssf <<
 			".PHONY: default all install clean\n"
 			".SUFFIXES:\n"
@@ -388,6 +391,7 @@ MakeGenerator::emit( const std::shared_ptr<Directory> &d,
 	{
 		{
 			std::ofstream f( makefn );
+			File::invalidateStatCache( makefn );
 
 			f <<
 				".PHONY: all\n"
@@ -410,10 +414,10 @@ MakeGenerator::emit( const std::shared_ptr<Directory> &d,
 				f << ' ' << argv[a];
 		}
 
-		TransformSet xform( d, conf.getSystem() );
-		Scope::root().transform( xform, conf );
+		std::shared_ptr<TransformSet> xform = GraphCache::transform( d, conf );
 
 		std::ofstream rf( d->makefilename( "Makefile.build" ) );
+		File::invalidateStatCache( d->makefilename( "Makefile.build" ) );
 		rf <<
 			".PHONY: default all install clean\n"
 			".SUFFIXES:\n"
@@ -423,7 +427,7 @@ MakeGenerator::emit( const std::shared_ptr<Directory> &d,
 
 		std::vector<std::string> defTargs;
 		int scopeCount = 0;
-		emitScope( rf, defTargs, *d, xform, scopeCount );
+		emitScope( rf, defTargs, *d, *xform, scopeCount );
 
 		rf << "all:";
 		for ( const std::string &a: defTargs )
@@ -435,6 +439,8 @@ MakeGenerator::emit( const std::shared_ptr<Directory> &d,
 		for ( const std::string &a: defTargs )
 			rf << " clean-" << a;
 		rf << "\n\n";
+
+		GlobManifest::addOutput( d->makefilename( "Makefile.build" ) );
 	}
 	catch ( std::exception &e )
 	{
@@ -26,13 +26,16 @@
 #include "LuaEngine.h"
 #include "BuildItem.h"
 #include "TransformSet.h"
-#include "Scope.h"
 #include "Debug.h"
 #include "StrUtil.h"
+#include "GlobManifest.h"
+#include "GraphCache.h"
 #include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <set>
+#include <map>
+#include <unordered_map>
 #include <unistd.h>
 
 
@@ -81,12 +84,120 @@ escape_path( const std::string &s )
 	return ret;
 }
 
+// the rules and tool variables of one scope of the transformed graph
+struct ScopeRules
+{
+	size_t parent;
+	std::map< std::shared_ptr<Tool>, std::string > names;
+	std::map<std::string, std::string> toolVars;
+	std::set<std::string> refs;
+	std::vector< std::pair<std::string, std::string> > writes;
+};
+
+// every rule is written once to a file included by the top level
+// build file, so the sub scopes look them up from there. A tool
+// that makes a different rule in another scope gets a variant named
+// with the hash of its text.
+struct RuleSet
+{
+	std::vector<ScopeRules> scopes;
+	std::map< std::string, std::vector< std::pair<std::string, std::string> > > variants;
+	std::set<std::string> scopeVars;
+	std::string text;
+};
+
+static std::string
+ruleBody( const Rule &r )
+{
+	std::stringstream os;
+	os << " command = " << r.getCommand() << '\n';
+	if ( ! r.getDescription().empty() )
+		os << " description = " << r.getDescription() << '\n';
+	const std::string &dFile = r.getDependencyFile();
+	if ( ! dFile.empty() )
+	{
+		os << " depfile = " << dFile << '\n';
+		const std::string &dStyle = r.getDependencyStyle();
+		if ( ! dStyle.empty() )
+			os << " deps = " << dStyle << '\n';
+	}
+	if ( r.isOutputRestat() )
+		os << " restat = 1\n";
+	const std::string &jPool = r.getJobPool();
+	if ( ! jPool.empty() )
+			os << " pool = " << jPool << '\n';
+	return os.str();
+}
+
+// adds the names of the variables referenced by the rule text
+static void
+addReferences( std::set<std::string> &refs, const std::string &body )
+{
+	for ( std::string::size_type p = body.find( '$' ); p != std::string::npos; p = body.find( '$', p ) )
+	{
+		++p;
+		if ( p == body.size() )
+			break;
+		if ( body[p] == '{' )
+		{
+			std::string::size_type e = body.find( '}', p );
+			if ( e == std::string::npos )
+				break;
+			refs.insert( body.substr( p + 1, e - p - 1 ) );
+			p = e + 1;
+			continue;
+		}
+		std::string::size_type e = p;
+		while ( e < body.size() && ( isalnum( static_cast<unsigned char>( body[e] ) ) || body[e] == '_' || body[e] == '-' ) )
+			++e;
+		if ( e > p )
+			refs.insert( body.substr( p, e - p ) );
+		else
+			++p;
+	}
+}
+
+static std::string
+ruleName( RuleSet &rs, const std::string &tag, std::string body )
+{
+	auto &vars = rs.variants[tag];
+	for ( auto &v: vars )
+	{
+		if ( v.second == body )
+			return v.first;
+	}
+
+	std::string name = tag;
+	if ( ! vars.empty() )
+	{
+		std::stringstream n;
+		n << tag << '_' << std::hex << std::setw( 8 ) << std::setfill( '0' )
+		  << ( File::hashBytes( body.data(), body.size() ) & 0xFFFFFFFF );
+		name = n.str();
+	}
+	rs.text.append( "\nrule " );
+	rs.text.append( name );
+	rs.text.push_back( '\n' );
+	rs.text.append( body );
+	vars.emplace_back( name, std::move( body ) );
+	return name;
+}
+
 static void
-emitRules( std::ostream &os, const TransformSet &x )
+collectRules( RuleSet &rs, const TransformSet &x, size_t parent )
 {
-	std::set< std::shared_ptr<Tool> > toolsInPlay;
-	for ( const std::shared_ptr<BuildItem> &bi: x.getBuildItems() )
-		toolsInPlay.insert( bi->getTool() );
+	// in the order the items first use them, so the output doesn't
+	// depend on where the tools were allocated (i.e. when they came
+	// from the graph cache)
+	const BuildGraph &g = x.getGraph();
+	std::vector< std::shared_ptr<Tool> > toolsInPlay;
+	std::set<const Tool *> seenTools;
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
+	{
+		const std::shared_ptr<Tool> &t = g.item( n )->getTool();
+		if ( t && seenTools.insert( t.get() ).second )
+			toolsInPlay.push_back( t );
+	}
 
 	// @TODO: Need to add variable lookup to substitute variables
 	//   so optimization flags, etc. can be swapped in
@@ -94,35 +205,141 @@ emitRules( std::ostream &os, const TransformSet &x )
 #ifdef WIN32
 	std::cerr << "Need to add a check for max command length and use a response file instead" << std::endl;
 #endif
+	size_t cur = rs.scopes.size();
+	rs.scopes.emplace_back();
+	rs.scopes.back().parent = parent;
 	for ( const std::shared_ptr<Tool> &t: toolsInPlay )
 	{
 		if ( t )
 		{
 			const Rule &r = t->createRule( x );
-			os << '\n';
+			std::string body = ruleBody( r );
+			ScopeRules &s = rs.scopes[cur];
+			addReferences( s.refs, body );
 			for ( auto &v: r.getVariables() )
-				os << v.first << '=' << v.second << '\n';
-			os << "\nrule " << r.getName() << '\n';
-			os << " command = " << r.getCommand() << '\n';
-			if ( ! r.getDescription().empty() )
-				os << " description = " << r.getDescription() << '\n';
-			const std::string &dFile = r.getDependencyFile();
-			if ( ! dFile.empty() )
+				s.toolVars[v.first] = v.second;
+			s.names[t] = ruleName( rs, r.getName(), std::move( body ) );
+		}
+	}
+	for ( auto &v: x.getVars() )
+		rs.scopeVars.insert( v.first );
+
+	for ( const std::shared_ptr<TransformSet> &i: x.getSubScopes() )
+		collectRules( rs, *i, cur );
+}
+
+// the tool variables are looked up from the scope of the build
+// statement when the command is run, so a value is only written
+// where it changes what the rules of that scope see. The most common
+// one goes in the included file.
+static void
+placeToolVariables( RuleSet &rs )
+{
+	std::set<std::string> names, hoisted;
+	for ( const ScopeRules &s: rs.scopes )
+	{
+		for ( auto &v: s.toolVars )
+			names.insert( v.first );
+	}
+	for ( const std::string &n: names )
+	{
+		// values referring to other variables are evaluated where
+		// they are written
+		bool canHoist = rs.scopeVars.find( n ) == rs.scopeVars.end();
+		for ( const ScopeRules &s: rs.scopes )
+		{
+			auto v = s.toolVars.find( n );
+			if ( v != s.toolVars.end() && v->second.find( '$' ) != std::string::npos )
+				canHoist = false;
+		}
+		if ( canHoist )
+			hoisted.insert( n );
+	}
+
+	// the value each scope saw when it defined all of its rules
+	auto seen = [&]( size_t si, const std::string &n ) -> std::string
+	{
+		for ( ;; )
+		{
+			const ScopeRules &s = rs.scopes[si];
+			auto v = s.toolVars.find( n );
+			if ( v != s.toolVars.end() )
+				return v->second;
+			if ( si == 0 )
+				return std::string();
+			si = s.parent;
+		}
+	};
+
+	std::vector< std::map<std::string, std::string> > current( rs.scopes.size() );
+	std::string defaults;
+	for ( const std::string &n: hoisted )
+	{
+		std::map<std::string, size_t> counts;
+		for ( size_t si = 0; si != rs.scopes.size(); ++si )
+		{
+			if ( rs.scopes[si].refs.find( n ) != rs.scopes[si].refs.end() )
+				++counts[seen( si, n )];
+		}
+		if ( counts.empty() )
+			continue;
+
+		std::string def;
+		if ( rs.scopes[0].refs.find( n ) != rs.scopes[0].refs.end() )
+			def = seen( 0, n );
+		else
+		{
+			size_t best = 0;
+			for ( auto &c: counts )
+			{
+				if ( c.second > best )
+				{
+					def = c.first;
+					best = c.second;
+				}
+			}
+		}
+		if ( ! def.empty() )
+			defaults.append( n + '=' + def + '\n' );
+		current[0][n] = std::move( def );
+	}
+	if ( ! defaults.empty() )
+		rs.text = '\n' + defaults + rs.text;
+
+	for ( size_t si = 0; si != rs.scopes.size(); ++si )
+	{
+		ScopeRules &s = rs.scopes[si];
+		if ( si != 0 )
+			current[si] = current[s.parent];
+		for ( auto &v: s.toolVars )
+		{
+			if ( hoisted.find( v.first ) == hoisted.end() )
+				s.writes.emplace_back( v.first, v.second );
+		}
+		for ( const std::string &n: s.refs )
+		{
+			auto c = current[si].find( n );
+			if ( c == current[si].end() )
+				continue;
+			std::string v = seen( si, n );
+			if ( c->second != v )
 			{
-				os << " depfile = " << dFile << '\n';
-				const std::string &dStyle = r.getDependencyStyle();
-				if ( ! dStyle.empty() )
-					os << " deps = " << dStyle << '\n';
+				s.writes.emplace_back( n, v );
+				c->second = std::move( v );
 			}
-			if ( r.isOutputRestat() )
-				os << " restat = 1\n";
-			const std::string &jPool = r.getJobPool();
-			if ( ! jPool.empty() )
-					os << " pool = " << jPool << '\n';
 		}
 	}
 }
 
+static void
+emitToolVariables( std::ostream &os, const ScopeRules &s )
+{
+	for ( auto &v: s.writes )
+		os << '\n' << v.first << '=' << v.second;
+	if ( ! s.writes.empty() )
+		os << '\n';
+}
+
 static void
 emitVariables( std::ostream &os, const TransformSet &x )
 {
@@ -148,9 +365,10 @@ emitVariables( std::ostream &os, const TransformSet &x )
 }
 
 static std::string
-addOutputList( std::ostream &os, const std::shared_ptr<BuildItem> &bi )
+addOutputList( std::ostream &os, const BuildGraph &g, BuildGraph::NodeID n )
 {
 	std::string outshort;
+	const std::shared_ptr<BuildItem> &bi = g.item( n );
 
 	auto outd = bi->getOutDir();
 	if ( outd )
@@ -176,83 +394,171 @@ addOutputList( std::ostream &os, const std::shared_ptr<BuildItem> &bi )
 
 	if ( ! bi->getTool() )
 	{
-		std::vector< std::shared_ptr<BuildItem> > deps =
-			bi->extractDependencies( DependencyType::EXPLICIT );
-		for ( auto &d: deps )
-			addOutputList( os, d );
+		for ( BuildGraph::NodeID d: g.dependencies( n, DependencyType::EXPLICIT ) )
+			addOutputList( os, g, d );
 		outshort.clear();
 	}
 
 	return outshort;
 }
 
+// the value of an item variable as added to the build statement
+static const std::string &
+itemVariableValue( const TransformSet &x, const std::shared_ptr<Tool> &t,
+				   const std::string &name, const Variable &v )
+{
+	if ( v.useToolFlagTransform() )
+	{
+		auto tt = x.getTool( v.getToolTag() );
+		if ( ! tt )
+			throw std::runtime_error( "Variable set to use tool flag transform, but no tool with tag '" + v.getToolTag() + "' found" );
+		return v.prepended_value( tt->getCommandPrefix( name ), x.getSystem() );
+	}
+	return v.prepended_value( t->getCommandPrefix( name ), x.getSystem() );
+}
+
+// values shorter than this aren't worth a variable
+static const size_t theMinSharedValue = 32;
+
 static void
-emitTargets( std::ostream &os, const TransformSet &x )
+emitTargets( std::ostream &os, const TransformSet &x, const ScopeRules &rules )
 {
-	for ( const std::shared_ptr<BuildItem> &bi: x.getBuildItems() )
+	const BuildGraph &g = x.getGraph();
+
+	// the flags propagated to the objects of a library or executable
+	// are the same for each of them, so a value used by more than one
+	// build statement is written once as a variable of this file and
+	// the statements refer to it. The build variables are expanded as
+	// they are read, so the commands come out the same.
+	struct ItemValue
+	{
+		const std::string *name;
+		size_t value;
+	};
+	struct SharedValue
 	{
+		const std::string *name;
+		const std::string *text;
+		size_t uses = 0;
+		std::string var;
+	};
+	std::vector<SharedValue> values;
+	std::unordered_map<std::string, size_t> valueIndex;
+	// the joined values of shared flag lists are the same string, so
+	// only the first use of one has to be hashed
+	std::unordered_map<const std::string *, size_t> textIndex;
+	std::vector< std::vector<ItemValue> > itemValues( g.itemCount() );
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
+	{
+		const std::shared_ptr<BuildItem> &bi = g.item( n );
+		auto t = bi->getTool();
+		if ( ! t && ! bi->isTopLevelItem() )
+			continue;
+
+		for ( auto &bv: bi->getVariables() )
+		{
+			const std::string &outv = itemVariableValue( x, t, bv.first, bv.second );
+			if ( outv.empty() )
+				continue;
+
+			size_t idx;
+			auto ti = textIndex.find( &outv );
+			if ( ti != textIndex.end() && *( values[ti->second].name ) == bv.first )
+				idx = ti->second;
+			else
+			{
+				std::string key = bv.first;
+				key.push_back( '\0' );
+				key.append( outv );
+				auto vi = valueIndex.emplace( std::move( key ), values.size() );
+				if ( vi.second )
+				{
+					values.emplace_back();
+					values.back().name = &( bv.first );
+					values.back().text = &outv;
+				}
+				idx = vi.first->second;
+				textIndex[&outv] = idx;
+			}
+			++values[idx].uses;
+			itemValues[n].push_back( ItemValue{ &( bv.first ), idx } );
+		}
+	}
+	std::unordered_map<std::string, size_t>().swap( valueIndex );
+	std::unordered_map<const std::string *, size_t>().swap( textIndex );
+
+	std::map<std::string, size_t> varCount;
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
+	{
+		for ( const ItemValue &iv: itemValues[n] )
+		{
+			SharedValue &sv = values[iv.value];
+			if ( sv.uses < 2 || sv.text->size() < theMinSharedValue || ! sv.var.empty() )
+				continue;
+			sv.var = *( iv.name ) + "__" + std::to_string( ++varCount[*( iv.name )] );
+			os << '\n' << sv.var << " = " << *( sv.text );
+		}
+	}
+	if ( ! varCount.empty() )
+		os << '\n';
+
+	for ( BuildGraph::NodeID n = 0; n != g.itemCount(); ++n )
+	{
+		const std::shared_ptr<BuildItem> &bi = g.item( n );
 		DEBUG( "Processing build item '" << bi->getName() << "'" );
 		auto t = bi->getTool();
 		if ( t || bi->isTopLevelItem() )
 		{
 			auto outd = bi->getOutDir();
 			os << "\nbuild";
-			std::string outshort = addOutputList( os, bi );
-			std::vector< std::shared_ptr<BuildItem> > deps;
+			std::string outshort = addOutputList( os, g, n );
 			if ( t )
 			{
-				os << ": " << t->getTag();
+				os << ": " << rules.names.find( t )->second;
 				if ( bi->useName() )
 					os << ' ' << escape_path( bi->getDir()->makefilename( bi->getName() ) );
 
-				deps = bi->extractDependencies( DependencyType::EXPLICIT );
-				for ( auto &d: deps )
-					addOutputList( os, d );
+				for ( BuildGraph::NodeID d: g.dependencies( n, DependencyType::EXPLICIT ) )
+					addOutputList( os, g, d );
 			}
 			else
 			{
 				os << ": phony";
 			}
 
-			deps = bi->extractDependencies( DependencyType::IMPLICIT );
+			BuildGraph::EdgeRange deps = g.dependencies( n, DependencyType::IMPLICIT );
 			if ( ! deps.empty() )
 			{
 				os << " |";
-				for ( auto &d: deps )
-					addOutputList( os, d );
+				for ( BuildGraph::NodeID d: deps )
+					addOutputList( os, g, d );
 			}
-			deps = bi->extractDependencies( DependencyType::ORDER );
+			deps = g.dependencies( n, DependencyType::ORDER );
 			if ( ! deps.empty() )
 			{
 				os << " ||";
-				for ( auto &d: deps )
-					addOutputList( os, d );
+				for ( BuildGraph::NodeID d: deps )
+					addOutputList( os, g, d );
 			}
 			if ( ! outshort.empty() )
 				os << "\n  out_short = " << outshort;
 
-			auto &bivars = bi->getVariables();
-			for ( auto &bv: bivars )
+			for ( const ItemValue &iv: itemValues[n] )
 			{
-				std::string outv;
-				if ( bv.second.useToolFlagTransform() )
+				const std::string &name = *( iv.name );
+				const SharedValue &sv = values[iv.value];
+				if ( name == "pool" && *( sv.text ) != "console" )
 				{
-					auto tt = x.getTool( bv.second.getToolTag() );
-					if ( ! tt )
-						throw std::runtime_error( "Variable set to use tool flag transform, but no tool with tag '" + bv.second.getToolTag() + "' found" );
-					outv = bv.second.prepended_value( tt->getCommandPrefix( bv.first ), x.getSystem() );
-				}
-				else
-					outv = bv.second.prepended_value( t->getCommandPrefix( bv.first ), x.getSystem() );
-				if ( bv.first == "pool" && outv != "console" )
-				{
-					if ( ! x.hasPool( outv ) )
+					if ( ! x.hasPool( *( sv.text ) ) )
 					{
-						std::cerr << "WARNING: Build Item '" << bi->getName() << "' set to use non-existent pool '" << outv << "'" << std::endl;
+						std::cerr << "WARNING: Build Item '" << bi->getName() << "' set to use non-existent pool '" << *( sv.text ) << "'" << std::endl;
 					}
 				}
-				if ( ! outv.empty() )
-					os << "\n  " << bv.first << "= $" << bv.first << ' ' << outv;
+				os << "\n  " << name << "= $" << name << ' ';
+				if ( sv.var.empty() )
+					os << *( sv.text );
+				else
+					os << '$' << sv.var;
 			}
 
 			if ( bi->isTopLevelItem() )
@@ -278,21 +584,24 @@ static void
 emitScope( std::ostream &os,
 		   const Directory &outD,
 		   const TransformSet &x,
+		   const RuleSet &rs,
 		   int &scopeCount )
 {
+	const ScopeRules &rules = rs.scopes[static_cast<size_t>( scopeCount )];
 	for ( const std::shared_ptr<TransformSet> &i: x.getSubScopes() )
 	{
 		std::stringstream subscopefn;
 		subscopefn << "sub_scope_" << (++scopeCount) << ".ninja";
 		std::string sfn = subscopefn.str();
 		std::ofstream ssf( outD.makefilename( sfn ) );
-		emitScope( ssf, outD, *i, scopeCount );
+		File::invalidateStatCache( outD.makefilename( sfn ) );
+		emitScope( ssf, outD, *i, rs, scopeCount );
 		os << "\nsubninja " << sfn << '\n';
 	}
 
 	emitVariables( os, x );
-	emitRules( os, x );
-	emitTargets( os, x );
+	emitToolVariables( os, rules );
+	emitTargets( os, x, rules );
 	os << '\n';
 }
 
@@ -347,14 +656,25 @@ NinjaGenerator::emit( const std::shared_ptr<Directory> &d,
 	try
 	{
 		std::ofstream f( buildfn );
+		File::invalidateStatCache( buildfn );
 		f << "ninja_required_version = 1.5\n";
 		f << "builddir = " << d->fullpath() << '\n';
 
-		TransformSet xform( d, conf.getSystem() );
-		Scope::root().transform( xform, conf );
+		std::shared_ptr<TransformSet> xform = GraphCache::transform( d, conf );
+
+		RuleSet rs;
+		collectRules( rs, *xform, 0 );
+		placeToolVariables( rs );
+		{
+			std::string rulefn = d->makefilename( "rules.ninja" );
+			std::ofstream rf( rulefn );
+			File::invalidateStatCache( rulefn );
+			rf << rs.text << '\n';
+		}
+		f << "include rules.ninja\n";
 
 		int scopeCount = 0;
-		emitScope( f, *d, xform, scopeCount );
+		emitScope( f, *d, *xform, rs, scopeCount );
 
 		Directory curD;
 		f <<
@@ -393,6 +713,7 @@ NinjaGenerator::emit( const std::shared_ptr<Directory> &d,
 
 			d->updateIfDifferent( "build.ninja.d", std::vector<std::string>{ deplist.str() } );
 		}
+		GlobManifest::addOutput( buildfn );
 
 		f << "\n\n";
 	}
@@ -28,6 +28,8 @@
 #include "Library.h"
 #include "PackageConfig.h"
 #include "Executable.h"
+#include "Directory.h"
+#include "ScopeGuard.h"
 
 
 ////////////////////////////////////////
@@ -117,6 +119,11 @@ OptionalSource::transform( TransformSet &xform ) const
 		bool ok = true;
 		std::vector<ItemPtr> extras;
 		PackageSet &ps = PackageSet::get( xform.getSystem() );
+		// packages found here are shared between configurations (which
+		// may be transformed in parallel), so don't have them pick up
+		// whichever output directory happens to be current
+		Directory::pushd( getDir() );
+		ON_EXIT{ Directory::popd(); };
 		for ( auto &l: myExternLibs )
 		{
 			auto elib = ps.find( l.first, l.second, xform.getLibSearchPath(), xform.getPkgSearchPath() );
@@ -232,7 +232,20 @@ PackageConfig::getAndReturn( const char *tag ) const
 void
 PackageConfig::parse( void )
 {
-	std::ifstream infl( myPackageFile );
+	parseFile( myPackageFile, myLocalVars, myValues );
+	promoteVariables();
+}
+
+
+////////////////////////////////////////
+
+
+void
+PackageConfig::parseFile( const std::string &pkgfile,
+						  std::map<std::string, std::string> &localVars,
+						  std::map<std::string, std::string> &values )
+{
+	std::ifstream infl( pkgfile );
 	std::string curline;
 	std::string parseline;
 	using std::swap;
@@ -269,9 +282,17 @@ PackageConfig::parse( void )
 		if ( parseline.empty() )
 			continue;
 
-		extractNameAndValue( parseline );
+		extractNameAndValue( pkgfile, parseline, localVars, values );
 	}
+}
+
+
+////////////////////////////////////////
 
+
+void
+PackageConfig::promoteVariables( void )
+{
 	// now promote everything to item variables we might care about
 	for ( auto &x: myLocalVars )
 		setVariable( x.first, x.second );
@@ -286,7 +307,10 @@ PackageConfig::parse( void )
 
 
 void
-PackageConfig::extractNameAndValue( const std::string &curline )
+PackageConfig::extractNameAndValue( const std::string &pkgfile,
+									const std::string &curline,
+									std::map<std::string, std::string> &localVars,
+									std::map<std::string, std::string> &values )
 {
 	std::string nm, val;
 
@@ -321,55 +345,55 @@ PackageConfig::extractNameAndValue( const std::string &curline )
 	if ( i < curline.size() )
 		val = curline.substr( i );
 
-	String::substituteVariables( val, true, myLocalVars );
+	String::substituteVariables( val, true, localVars );
 
 	if ( separator == ':' )
 	{
-		if ( myValues.find( nm ) != myValues.end() )
+		if ( values.find( nm ) != values.end() )
 		{
-			std::cerr << "WARNING: Package config file '" << myPackageFile << "' has multiple entries for tag '" << nm << "'" << std::endl;
+			std::cerr << "WARNING: Package config file '" << pkgfile << "' has multiple entries for tag '" << nm << "'" << std::endl;
 			return;
 		}
 
 		if ( nm == "Name" || nm == "Description" || nm == "URL" )
 		{
-			myValues[nm] = val;
+			values[nm] = val;
 		}
 		else if ( nm == "Version" )
 		{
-			myValues[nm] = val;
+			values[nm] = val;
 		}
 		else if ( nm == "Libs.private" || nm == "Libs" )
 		{
 			// pkg-config parses these as shell arguments and attempts to collapse them when
 			// chained, let's not bother with that, it doesn't seem needed
-			myValues[nm] = val;
+			values[nm] = val;
 		}
 		else if ( nm == "Requires.private" || nm == "Requires" )
 		{
-			myValues[nm] = val;
+			values[nm] = val;
 		}
 		else if ( nm == "Cflags" || nm == "CFlags" )
 		{
 			// make sure we only have to look up by the one name later
-			myValues["CFlags"] = val;
+			values["CFlags"] = val;
 		}
 		else if ( nm == "Conflicts" )
 		{
 			// do we care about this???
-			myValues[nm] = val;
+			values[nm] = val;
 		}
 		else
 		{
 			DEBUG( "WARNING: Ignoring unknown package config tag: '" << nm << "', value: " << val );
-			myValues[nm] = val;
+			values[nm] = val;
 		}
 	}
 	else if ( separator == '=' )
 	{
-		if ( myLocalVars.find( nm ) != myLocalVars.end() )
+		if ( localVars.find( nm ) != localVars.end() )
 		{
-			std::cerr << "WARNING: Package config file '" << myPackageFile << "' has multiple entries for variable '" << nm << "'" << std::endl;
+			std::cerr << "WARNING: Package config file '" << pkgfile << "' has multiple entries for variable '" << nm << "'" << std::endl;
 			return;
 		}
 		// do we need to implement the special handling
@@ -380,11 +404,11 @@ PackageConfig::extractNameAndValue( const std::string &curline )
 //		{
 //			
 //		}
-		myLocalVars[nm] = val;
+		localVars[nm] = val;
 	}
 	else
 	{
-		std::cerr << "WARNING: Ignoring bogus line in pkg config file: " << myPackageFile << ": " << curline << std::endl;
+		std::cerr << "WARNING: Ignoring bogus line in pkg config file: " << pkgfile << ": " << curline << std::endl;
 	}
 }
 
@@ -61,7 +61,18 @@ private:
 	const std::string &getAndReturn( const char *tag ) const;
 
 	void parse( void );
-	void extractNameAndValue( const std::string &curline );
+	// publishes the parsed (or restored from cache) values as variables
+	void promoteVariables( void );
+
+	// reads a .pc file into its local variables and (expanded) fields,
+	// touches no shared state so may be run from any thread
+	static void parseFile( const std::string &pkgfile,
+						   std::map<std::string, std::string> &localVars,
+						   std::map<std::string, std::string> &values );
+	static void extractNameAndValue( const std::string &pkgfile,
+									 const std::string &curline,
+									 std::map<std::string, std::string> &localVars,
+									 std::map<std::string, std::string> &values );
 	friend class PackageSet;
 
 	std::string myPackageFile;
@@ -33,6 +33,8 @@
 #include <algorithm>
 #include <utility>
 #include <map>
+#include <sstream>
+#include <iomanip>
 
 #include "StrUtil.h"
 #include "FileUtil.h"
@@ -40,6 +42,21 @@
 #include "OSUtil.h"
 #include "ScopeGuard.h"
 #include "Debug.h"
+#include "CacheData.h"
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+std::map< std::string, std::unique_ptr<PackageSet> > theSets;
+std::mutex theSetsMutex;
+
+const char thePackageIndexMagic[8] = { 'C', 'T', 'O', 'R', 'P', 'K', 'G', '1' };
+
+} // empty namespace
 
 
 ////////////////////////////////////////
@@ -48,9 +65,9 @@
 void
 PackageSet::resetPackageSearchPath( void )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	myPkgSearchPath.clear();
 	myInit = false;
-	myPackageConfigs.clear();
 }
 
 
@@ -60,6 +77,7 @@ PackageSet::resetPackageSearchPath( void )
 void
 PackageSet::setPackageSearchPath( const std::string &p )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	resetPackageSearchPath();
 	addPackagePath( p );
 }
@@ -71,9 +89,11 @@ PackageSet::setPackageSearchPath( const std::string &p )
 void
 PackageSet::addPackagePath( const std::string &p )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	// all internal things like this are to be
 	// in unix path style
 	String::split_append( myPkgSearchPath, p, ':' );
+	myInit = false;
 }
 
 
@@ -83,7 +103,9 @@ PackageSet::addPackagePath( const std::string &p )
 void
 PackageSet::resetLibSearchPath( void )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	myLibSearchPath.clear();
+	myInit = false;
 }
 
 
@@ -93,6 +115,7 @@ PackageSet::resetLibSearchPath( void )
 void
 PackageSet::setLibSearchPath( const std::string &p )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	resetLibSearchPath();
 	addLibPath( p );
 }
@@ -104,9 +127,11 @@ PackageSet::setLibSearchPath( const std::string &p )
 void
 PackageSet::addLibPath( const std::string &p )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	// all internal things like this are to be
 	// in unix path style
 	String::split_append( myLibSearchPath, p, ':' );
+	myInit = false;
 }
 
 
@@ -165,60 +190,35 @@ PackageSet::find( const std::string &name,
 				  const std::vector<std::string> &libPath,
 				  const std::vector<std::string> &pkgPath )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
+	if ( libPath.empty() && pkgPath.empty() )
+		return find( name, reqVersion );
+
+	// the caches are keyed by search path, so swapping the paths
+	// in only selects a different (possibly already scanned) set
 	std::vector<std::string> tl;
 	std::vector<std::string> tp;
-	std::map<std::string, std::string> tpc;
-	std::map<std::string, std::shared_ptr<PackageConfig> > tppc;
-
 	if ( ! libPath.empty() )
 	{
+		tl = libPath;
 		std::swap( tl, myLibSearchPath );
-		myLibSearchPath = libPath;
 	}
-
-	bool restorpkg = false;
 	if ( ! pkgPath.empty() )
 	{
-		myInit = false;
-		restorpkg = true;
+		tp = pkgPath;
 		std::swap( tp, myPkgSearchPath );
-		myPkgSearchPath = pkgPath;
-		std::swap( tpc, myPackageConfigs );
-		std::swap( tppc, myParsedPackageConfigs );
 	}
-
-	//std::cout << "searching for '" << name << "' in:";
-	//for ( auto &p: myPkgSearchPath )
-	//	std::cout << "\n  " << p;
-	//std::cout << std::endl;
-	try
-	{
-		auto ret = find( name, reqVersion );
-		myInit = false;
-		if ( ! tl.empty() )
-			std::swap( myLibSearchPath, tl );
-		if ( restorpkg )
-		{
-			std::swap( myPkgSearchPath, tp );
-			std::swap( myPackageConfigs, tpc );
-			std::swap( myParsedPackageConfigs, tppc );
-		}
-		return ret;
-	}
-	catch ( ... )
-	{
-		if ( ! tl.empty() )
+	myInit = false;
+	ON_EXIT{
+		if ( ! libPath.empty() )
 			std::swap( myLibSearchPath, tl );
-		if ( restorpkg )
-		{
+		if ( ! pkgPath.empty() )
 			std::swap( myPkgSearchPath, tp );
-			std::swap( myPackageConfigs, tpc );
-			std::swap( myParsedPackageConfigs, tppc );
-		}
-		throw;
-	}
-}
+		myInit = false;
+	};
 
+	return find( name, reqVersion );
+}
 
 
 ////////////////////////////////////////
@@ -227,24 +227,26 @@ PackageSet::find( const std::string &name,
 std::shared_ptr<PackageConfig>
 PackageSet::find( const std::string &name, VersionCompare comp, const std::string &reqVersion )
 {
+	std::lock_guard<std::recursive_mutex> lk( myMutex );
 	init();
 
 	std::shared_ptr<PackageConfig> ret;
 
-	auto preparsed = myParsedPackageConfigs.find( name );
-	if ( preparsed != myParsedPackageConfigs.end() )
+	ParsedConfigs &parsed = *myCurParsed;
+	auto preparsed = parsed.find( name );
+	if ( preparsed != parsed.end() )
 		ret = preparsed->second;
 	else
 	{
-		auto f = myPackageConfigs.find( name );
-		if ( f != myPackageConfigs.end() )
+		auto f = myCurConfigs->configs.find( name );
+		if ( f != myCurConfigs->configs.end() )
 		{
 			DEBUG( "using pkg-config information for " << name );
 			ret = std::make_shared<PackageConfig>( f->first, f->second );
 			// we can't call this in the constructor
-			ret->parse();
+			parse( *ret );
 			//std::cout << "found package '" << name << "' for system " << mySystem << std::endl;
-			myParsedPackageConfigs[f->first] = ret;
+			parsed[f->first] = ret;
 			// pull in any dependent libraries
 			extractOtherModules( *ret, ret->getRequires(), true );
 			//extractOtherModules( *ret, ret->getStaticRequires(), true );
@@ -252,6 +254,7 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 		else
 		{
 			DEBUG( "Searching in OS path for library " << name );
+			myInputs.insert( myLibSearchPath.begin(), myLibSearchPath.end() );
 			std::string libpath;
 			if ( mySystem == "Darwin" )
 			{
@@ -259,13 +262,13 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 				if ( File::find( libpath, name, {".framework"}, myLibSearchPath ) )
 				{
 					ret = makeLibraryReference( name, libpath );
-					myParsedPackageConfigs[name] = ret;
+					parsed[name] = ret;
 				}
 				// look for framework
 				else if ( File::find( libpath, "lib" + name, {".dylib", ".a"}, myLibSearchPath ) )
 				{
 					ret = makeLibraryReference( name, libpath );
-					myParsedPackageConfigs[name] = ret;
+					parsed[name] = ret;
 				}
 				else
 				{
@@ -277,7 +280,7 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 						if ( File::find( libpath, "lib" + altname, {".dylib", ".a"}, myLibSearchPath ) )
 						{
 							ret = makeLibraryReference( altname, libpath );
-							myParsedPackageConfigs[name] = ret;
+							parsed[name] = ret;
 						}
 					}
 				}
@@ -287,13 +290,13 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 				if ( File::find( libpath, name, {".lib", ".a"}, myLibSearchPath ) )
 				{
 					ret = makeLibraryReference( name, libpath );
-					myParsedPackageConfigs[name] = ret;
+					parsed[name] = ret;
 				}
 				else if ( File::find( libpath, "lib" + name, {".dll.a", ".a"}, myLibSearchPath ) )
 				{
 					// for mingw
 					ret = makeLibraryReference( name, libpath );
-					myParsedPackageConfigs[name] = ret;
+					parsed[name] = ret;
 				}
 				else
 				{
@@ -305,7 +308,7 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 						if ( File::find( libpath, altname, {".lib", ".a"}, myLibSearchPath ) )
 						{
 							ret = makeLibraryReference( altname, libpath );
-							myParsedPackageConfigs[name] = ret;
+							parsed[name] = ret;
 						}
 					}
 				}
@@ -315,7 +318,7 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 				if ( File::find( libpath, "lib" + name, {".so", ".a"}, myLibSearchPath ) )
 				{
 					ret = makeLibraryReference( name, libpath );
-					myParsedPackageConfigs[name] = ret;
+					parsed[name] = ret;
 				}
 				else
 				{
@@ -327,7 +330,7 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 						if ( File::find( libpath, "lib" + altname, {".so", ".a"}, myLibSearchPath ) )
 						{
 							ret = makeLibraryReference( altname, libpath );
-							myParsedPackageConfigs[name] = ret;
+							parsed[name] = ret;
 						}
 					}
 				}
@@ -372,15 +375,52 @@ PackageSet::find( const std::string &name, VersionCompare comp, const std::strin
 PackageSet &
 PackageSet::get( const std::string &sys )
 {
-	static std::map<std::string, PackageSet> theSets;
 	if ( sys.empty() )
 		return get( OS::system() );
 
-	auto i = theSets.find( sys );
-	if ( i == theSets.end() )
-		return theSets.emplace( std::make_pair( sys, PackageSet( sys ) ) ).first->second;
+	std::lock_guard<std::mutex> lk( theSetsMutex );
+	std::unique_ptr<PackageSet> &ps = theSets[sys];
+	if ( ! ps )
+		ps.reset( new PackageSet( sys ) );
 
-	return i->second;
+	return *ps;
+}
+
+
+////////////////////////////////////////
+
+
+void
+PackageSet::writeCaches( void )
+{
+	std::lock_guard<std::mutex> lk( theSetsMutex );
+	for ( auto &ps: theSets )
+	{
+		std::lock_guard<std::recursive_mutex> plk( ps.second->myMutex );
+		for ( auto &ci: ps.second->myPackageConfigs )
+		{
+			if ( ci.second.dirty )
+			{
+				ps.second->save( ci.second );
+				ci.second.dirty = false;
+			}
+		}
+	}
+}
+
+
+////////////////////////////////////////
+
+
+void
+PackageSet::addInputs( std::vector<std::string> &files )
+{
+	std::lock_guard<std::mutex> lk( theSetsMutex );
+	for ( auto &ps: theSets )
+	{
+		std::lock_guard<std::recursive_mutex> plk( ps.second->myMutex );
+		files.insert( files.end(), ps.second->myInputs.begin(), ps.second->myInputs.end() );
+	}
 }
 
 
@@ -445,13 +485,75 @@ PackageSet::init( void )
 		return;
 	myInit = true;
 
-	DEBUG( "---------- PackageSet::init --------------" );
-
+	std::string key;
 	for ( auto &i: myPkgSearchPath )
 	{
 		// first trim any trailing slashes, win32 opendir doesn't seem to like it
 		String::strip( i );
 		File::trimTrailingSeparators( i );
+		key.append( i );
+		key.push_back( '\n' );
+	}
+
+	auto ci = myPackageConfigs.find( key );
+	if ( ci == myPackageConfigs.end() )
+	{
+		ci = myPackageConfigs.emplace( key, ConfigIndex() ).first;
+		scan( ci->second );
+	}
+	myCurConfigs = &( ci->second );
+	myInputs.insert( myPkgSearchPath.begin(), myPkgSearchPath.end() );
+
+	// library references are found through the lib search path, so
+	// the parsed set depends on both
+	key.push_back( '\0' );
+	for ( auto &i: myLibSearchPath )
+	{
+		key.append( i );
+		key.push_back( '\n' );
+	}
+	myCurParsed = &( myParsedPackageConfigs[key] );
+}
+
+
+////////////////////////////////////////
+
+
+void
+PackageSet::scan( ConfigIndex &idx )
+{
+	if ( ! File::getCacheDirectory().empty() )
+	{
+		std::string key = mySystem;
+		for ( auto &i: myPkgSearchPath )
+		{
+			key.push_back( '\0' );
+			key.append( i );
+		}
+		std::stringstream fn;
+		fn << File::getCacheDirectory() << File::pathSeparator() << "pkgconfig"
+		   << File::pathSeparator() << std::hex << std::setw( 16 )
+		   << std::setfill( '0' ) << File::hashBytes( key.data(), key.size() ) << ".idx";
+		idx.cacheFile = fn.str();
+		if ( load( idx ) )
+		{
+			DEBUG( "using cached package index " << idx.cacheFile );
+			return;
+		}
+	}
+
+	DEBUG( "---------- PackageSet::scan --------------" );
+
+	idx.configs.clear();
+	idx.dirTimes.clear();
+	idx.dirty = true;
+	for ( auto &i: myPkgSearchPath )
+	{
+		// record the time before reading so anything added while
+		// we read is seen as a change next time
+		int64_t sec = -1, nsec = -1;
+		File::modTime( i, sec, nsec );
+		idx.dirTimes.emplace_back( sec, nsec );
 
 		DIR *d = ::opendir( i.c_str() );
 		if ( d )
@@ -480,13 +582,13 @@ PackageSet::init( void )
 					{
 						std::string name = cname.substr( 0, ePC );
 						// if we found the same name earlier, ignore this one
-						if ( myPackageConfigs.find( name ) == myPackageConfigs.end() )
+						if ( idx.configs.find( name ) == idx.configs.end() )
 						{
 							std::string fullpath = i;
 							fullpath.push_back( File::pathSeparator() );
 							fullpath.append( cname );
 							DEBUG( name << ": " << fullpath );
-							myPackageConfigs[name] = fullpath;
+							idx.configs[name] = fullpath;
 						}
 					}
 				}
@@ -521,12 +623,12 @@ PackageSet::init( void )
 					{
 						std::string name = cname.substr( 0, ePC );
 						// if we found the same name earlier, ignore this one
-						if ( myPackageConfigs.find( name ) == myPackageConfigs.end() )
+						if ( idx.configs.find( name ) == idx.configs.end() )
 						{
 							std::string fullpath = i;
 							fullpath.push_back( File::pathSeparator() );
 							fullpath.append( cname );
-							myPackageConfigs[name] = fullpath;
+							idx.configs[name] = fullpath;
 						}
 					}
 				}
@@ -540,6 +642,137 @@ PackageSet::init( void )
 ////////////////////////////////////////
 
 
+bool
+PackageSet::load( ConfigIndex &idx )
+{
+	std::string data;
+	if ( ! File::readCacheFile( idx.cacheFile, data ) ||
+		 data.compare( 0, sizeof(thePackageIndexMagic), thePackageIndexMagic, sizeof(thePackageIndexMagic) ) != 0 )
+		return false;
+
+	CacheData::Reader rdr( data, sizeof(thePackageIndexMagic) );
+	std::string sys;
+	int64_t nDirs;
+	if ( ! rdr.get( sys ) || sys != mySystem || ! rdr.get( nDirs ) ||
+		 nDirs != static_cast<int64_t>( myPkgSearchPath.size() ) )
+		return false;
+
+	// any directory that changed (a .pc file added or removed) means
+	// the name index has to be rebuilt
+	bool current = true;
+	std::vector<std::pair<int64_t, int64_t>> times;
+	for ( auto &i: myPkgSearchPath )
+	{
+		std::string dir;
+		int64_t sec, nsec;
+		if ( ! rdr.get( dir ) || ! rdr.get( sec ) || ! rdr.get( nsec ) || dir != i )
+			return false;
+		int64_t cursec = -1, curnsec = -1;
+		File::modTime( i, cursec, curnsec );
+		if ( cursec != sec || curnsec != nsec )
+			current = false;
+		times.emplace_back( sec, nsec );
+	}
+
+	std::map<std::string, std::string> configs;
+	int64_t nParsed;
+	if ( ! rdr.get( configs ) || ! rdr.get( nParsed ) )
+		return false;
+
+	// parsed entries are checked against their own file when used,
+	// so are worth keeping even when the index is stale
+	std::map<std::string, ParsedFile> parsed;
+	for ( int64_t i = 0; i < nParsed; ++i )
+	{
+		std::string fn;
+		ParsedFile pf;
+		if ( ! rdr.get( fn ) || ! rdr.get( pf.mtimeSec ) || ! rdr.get( pf.mtimeNSec ) ||
+			 ! rdr.get( pf.localVars ) || ! rdr.get( pf.values ) )
+			return false;
+		parsed[fn] = std::move( pf );
+	}
+
+	idx.parsed = std::move( parsed );
+	if ( ! current )
+		return false;
+
+	idx.dirTimes = std::move( times );
+	idx.configs = std::move( configs );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+void
+PackageSet::save( const ConfigIndex &idx )
+{
+	if ( idx.cacheFile.empty() )
+		return;
+
+	std::string out( thePackageIndexMagic, sizeof(thePackageIndexMagic) );
+	CacheData::put( out, mySystem );
+	CacheData::put( out, static_cast<int64_t>( myPkgSearchPath.size() ) );
+	for ( size_t i = 0; i != idx.dirTimes.size(); ++i )
+	{
+		CacheData::put( out, myPkgSearchPath[i] );
+		CacheData::put( out, idx.dirTimes[i].first );
+		CacheData::put( out, idx.dirTimes[i].second );
+	}
+	CacheData::put( out, idx.configs );
+	CacheData::put( out, static_cast<int64_t>( idx.parsed.size() ) );
+	for ( auto &pf: idx.parsed )
+	{
+		CacheData::put( out, pf.first );
+		CacheData::put( out, pf.second.mtimeSec );
+		CacheData::put( out, pf.second.mtimeNSec );
+		CacheData::put( out, pf.second.localVars );
+		CacheData::put( out, pf.second.values );
+	}
+
+	File::writeCacheFile( idx.cacheFile, out );
+}
+
+
+////////////////////////////////////////
+
+
+void
+PackageSet::parse( PackageConfig &pc )
+{
+	ConfigIndex &idx = *myCurConfigs;
+	int64_t sec = -1, nsec = -1;
+	bool haveTime = File::modTime( pc.getFilename(), sec, nsec );
+	myInputs.insert( pc.getFilename() );
+
+	auto pf = idx.parsed.find( pc.getFilename() );
+	if ( haveTime && pf != idx.parsed.end() &&
+		 pf->second.mtimeSec == sec && pf->second.mtimeNSec == nsec )
+	{
+		DEBUG( "using cached pkg-config values for " << pc.getFilename() );
+		pc.myLocalVars = pf->second.localVars;
+		pc.myValues = pf->second.values;
+		pc.promoteVariables();
+		return;
+	}
+
+	pc.parse();
+	if ( haveTime )
+	{
+		ParsedFile &e = idx.parsed[pc.getFilename()];
+		e.mtimeSec = sec;
+		e.mtimeNSec = nsec;
+		e.localVars = pc.myLocalVars;
+		e.values = pc.myValues;
+		idx.dirty = true;
+	}
+}
+
+
+////////////////////////////////////////
+
+
 namespace {
 enum class ModNameParseState
 {
@@ -550,17 +783,21 @@ enum class ModNameParseState
 	LOOKING_VER = 4,
 	IN_VERSION = 5
 };
-}
 
-void
-PackageSet::extractOtherModules( PackageConfig &pc, const std::string &val, bool required )
+struct ModuleSpec
 {
-	if ( val.empty() )
-		return;
-
-	++myParseDepth;
-	ON_EXIT{ --myParseDepth; };
+	std::string name;
+	std::string op;
+	std::string version;
+	bool hasOp = false;
+};
 
+// splits a Requires style list into the module names and any
+// version checks, in the order listed
+std::vector<ModuleSpec>
+splitModules( const std::string &val )
+{
+	std::vector<ModuleSpec> ret;
 	std::string::size_type p = 0, N = val.size();
 	std::string::size_type nameStart = std::string::npos;
 	std::string::size_type nameEnd = std::string::npos;
@@ -664,55 +901,81 @@ PackageSet::extractOtherModules( PackageConfig &pc, const std::string &val, bool
 			if ( nameStart == std::string::npos || nameEnd == std::string::npos )
 				throw std::logic_error( "Error in state machine parsing module names" );
 
-			std::string name = val.substr( nameStart, nameEnd - nameStart );
-			std::shared_ptr<PackageConfig> cur;
-			std::string verC, ver;
+			ModuleSpec m;
+			m.name = val.substr( nameStart, nameEnd - nameStart );
 			if ( opStart != std::string::npos )
 			{
-				if ( verStart == std::string::npos || verEnd == std::string::npos )
+				m.hasOp = true;
+				if ( verStart != std::string::npos && verEnd != std::string::npos )
 				{
-					std::cerr << "ERROR: mal-formed package module version check specification: found operator but no version to check against" << std::endl;
-					cur = find( name );
-				}
-				else
-				{
-					ver = val.substr( verStart, verEnd - verStart );
-					verC = val.substr( opStart, opEnd - opStart );
-					VersionCompare vc = VersionCompare::ANY;
-					if ( verC == "=" )
-						vc = VersionCompare::EQUAL;
-					else if ( verC == "!=" )
-						vc = VersionCompare::NOT_EQUAL;
-					else if ( verC == "<" )
-						vc = VersionCompare::LESS;
-					else if ( verC == "<=" )
-						vc = VersionCompare::LESS_EQUAL;
-					else if ( verC == ">" )
-						vc = VersionCompare::GREATER;
-					else if ( verC == ">=" )
-						vc = VersionCompare::GREATER_EQUAL;
-					else
-						throw std::runtime_error( "Invalid operator string: " + verC );
-					cur = find( name, vc, ver );
+					m.version = val.substr( verStart, verEnd - verStart );
+					m.op = val.substr( opStart, opEnd - opStart );
 				}
 			}
-			else
-				cur = find( name );
+			ret.emplace_back( std::move( m ) );
+		}
+		lastState = curState;
+		++p;
+	}
+	return ret;
+}
+
+} // empty namespace
+
 
-			if ( required && ! cur )
+////////////////////////////////////////
+
+
+void
+PackageSet::extractOtherModules( PackageConfig &pc, const std::string &val, bool required )
+{
+	if ( val.empty() )
+		return;
+
+	for ( const ModuleSpec &m: splitModules( val ) )
+	{
+		std::shared_ptr<PackageConfig> cur;
+		if ( m.hasOp )
+		{
+			if ( m.version.empty() )
 			{
-				std::stringstream msg;
-				msg << pc.getPackage() << ": Unable to find required package '" << name << "'";
-				if ( ! ver.empty() )
-					msg << ", version " << verC << ' '<< ver;
-				msg << " - please ensure it is installed or the package config search path is set appropriately";
-				throw std::runtime_error( msg.str() );
+				std::cerr << "ERROR: mal-formed package module version check specification: found operator but no version to check against" << std::endl;
+				cur = find( m.name );
+			}
+			else
+			{
+				VersionCompare vc = VersionCompare::ANY;
+				if ( m.op == "=" )
+					vc = VersionCompare::EQUAL;
+				else if ( m.op == "!=" )
+					vc = VersionCompare::NOT_EQUAL;
+				else if ( m.op == "<" )
+					vc = VersionCompare::LESS;
+				else if ( m.op == "<=" )
+					vc = VersionCompare::LESS_EQUAL;
+				else if ( m.op == ">" )
+					vc = VersionCompare::GREATER;
+				else if ( m.op == ">=" )
+					vc = VersionCompare::GREATER_EQUAL;
+				else
+					throw std::runtime_error( "Invalid operator string: " + m.op );
+				cur = find( m.name, vc, m.version );
 			}
-			if ( cur )
-				pc.addDependency( DependencyType::EXPLICIT, cur );
 		}
-		lastState = curState;
-		++p;
+		else
+			cur = find( m.name );
+
+		if ( required && ! cur )
+		{
+			std::stringstream msg;
+			msg << pc.getPackage() << ": Unable to find required package '" << m.name << "'";
+			if ( ! m.version.empty() )
+				msg << ", version " << m.op << ' '<< m.version;
+			msg << " - please ensure it is installed or the package config search path is set appropriately";
+			throw std::runtime_error( msg.str() );
+		}
+		if ( cur )
+			pc.addDependency( DependencyType::EXPLICIT, cur );
 	}
 }
 
@@ -23,6 +23,8 @@
 #pragma once
 
 #include "PackageConfig.h"
+#include <mutex>
+#include <set>
 
 
 ////////////////////////////////////////
@@ -62,6 +64,16 @@ public:
 
 	static PackageSet &get( const std::string &sys = std::string() );
 
+	/// writes out any package indices that changed this run to the
+	/// cache directory, so the next run can skip scanning the
+	/// search path and parsing the .pc files
+	static void writeCaches( void );
+
+	/// appends the .pc files and search directories the lookups of
+	/// this run depended on (a package or library found elsewhere
+	/// changes the directory), for the caches of the evaluation
+	static void addInputs( std::vector<std::string> &files );
+
 private:
 	PackageSet( const std::string &sys );
 
@@ -72,14 +84,53 @@ private:
 	std::shared_ptr<PackageConfig> makeLibraryReference( const std::string &name,
 														 const std::string &path );
 
+	// the parsed fields of a .pc file, kept with the modification
+	// time they were read at
+	struct ParsedFile
+	{
+		int64_t mtimeSec = 0;
+		int64_t mtimeNSec = 0;
+		std::map<std::string, std::string> localVars;
+		std::map<std::string, std::string> values;
+	};
+
+	struct ConfigIndex
+	{
+		std::string cacheFile;
+		// modification time of each search directory when scanned
+		std::vector<std::pair<int64_t, int64_t>> dirTimes;
+		// package name to .pc file
+		std::map<std::string, std::string> configs;
+		// .pc file to its contents
+		std::map<std::string, ParsedFile> parsed;
+		bool dirty = false;
+	};
+	typedef std::map<std::string, std::shared_ptr<PackageConfig>> ParsedConfigs;
+
+	void scan( ConfigIndex &idx );
+	bool load( ConfigIndex &idx );
+	void save( const ConfigIndex &idx );
+	void parse( PackageConfig &pc );
+
 	std::string mySystem;
 	std::vector<std::string> myPkgSearchPath;
 	std::vector<std::string> myLibSearchPath;
 
-	std::map<std::string, std::string> myPackageConfigs;
-	std::map<std::string, std::shared_ptr<PackageConfig>> myParsedPackageConfigs;
-	int myParseDepth = 0;
+	// the scanned .pc files are kept per package search path (and
+	// persisted in the cache directory between runs), and the parsed
+	// results per package + library search path, so toolsets that
+	// override the search paths only pay for the directory scan and
+	// parse once
+	std::map<std::string, ConfigIndex> myPackageConfigs;
+	std::map<std::string, ParsedConfigs> myParsedPackageConfigs;
+	ConfigIndex *myCurConfigs = nullptr;
+	ParsedConfigs *myCurParsed = nullptr;
 	bool myInit = false;
+	std::set<std::string> myInputs;
+
+	// lookups may come from several threads at once (i.e. subprojects
+	// evaluated in parallel), and recurse through Requires
+	std::recursive_mutex myMutex;
 };
 
 
@@ -40,7 +40,7 @@ namespace
 {
 
 static std::shared_ptr<Scope> theRootScope;
-static std::stack< std::shared_ptr<Scope> > theScopes;
+static thread_local std::stack< std::shared_ptr<Scope> > theScopes;
 
 } // empty namespace
 
@@ -408,6 +408,8 @@ Scope::transform( TransformSet &xform,
 
 	for ( const ItemPtr &i: myItems )
 		i->copyDependenciesToBuild( xform );
+
+	xform.freeze();
 }
 
 
@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "Symbol.h"
+
+#include <unordered_set>
+#include <mutex>
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+// never destroyed, so symbols held by other statics stay valid
+// through exit
+struct SymbolTable
+{
+	std::mutex mutex;
+	std::unordered_set<std::string> strings;
+	const std::string *empty;
+
+	SymbolTable( void )
+	{
+		strings.reserve( 4096 );
+		empty = &( *( strings.emplace().first ) );
+	}
+
+	const std::string *intern( const std::string &s )
+	{
+		if ( s.empty() )
+			return empty;
+		std::lock_guard<std::mutex> lk( mutex );
+		return &( *( strings.insert( s ).first ) );
+	}
+};
+
+SymbolTable &
+theSymbols( void )
+{
+	static SymbolTable *theTable = new SymbolTable;
+	return *theTable;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+Symbol::Symbol( void )
+		: myStr( theSymbols().empty )
+{
+}
+
+
+////////////////////////////////////////
+
+
+Symbol::Symbol( const std::string &s )
+		: myStr( theSymbols().intern( s ) )
+{
+}
+
+
+////////////////////////////////////////
+
+
+Symbol::Symbol( const char *s )
+		: myStr( s ? theSymbols().intern( std::string( s ) ) : theSymbols().empty )
+{
+}
+
+
+////////////////////////////////////////
+
+
+size_t
+Symbol::count( void )
+{
+	SymbolTable &t = theSymbols();
+	std::lock_guard<std::mutex> lk( t.mutex );
+	return t.strings.size();
+}
+
@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <string>
+#include <functional>
+
+
+////////////////////////////////////////
+
+
+/// @brief Class Symbol is a handle to an interned string.
+///
+/// All symbols with the same text share a single, immutable copy of
+/// that text which lives for the rest of the run, so copying a symbol
+/// is a pointer copy and comparing two symbols for equality is a
+/// pointer compare. Ordering is by the text, so anything sorted by
+/// symbol sorts the same as it would by string.
+///
+/// Interning is thread safe.
+class Symbol
+{
+public:
+	Symbol( void );
+	explicit Symbol( const std::string &s );
+	explicit Symbol( const char *s );
+
+	inline const std::string &str( void ) const;
+	inline operator const std::string &( void ) const;
+	inline const char *c_str( void ) const;
+	inline bool empty( void ) const;
+
+	inline bool operator==( const Symbol &o ) const;
+	inline bool operator!=( const Symbol &o ) const;
+	inline bool operator<( const Symbol &o ) const;
+
+	/// number of distinct symbols interned so far
+	static size_t count( void );
+
+private:
+	const std::string *myStr;
+};
+
+
+////////////////////////////////////////
+
+
+inline const std::string &Symbol::str( void ) const { return *myStr; }
+inline Symbol::operator const std::string &( void ) const { return *myStr; }
+inline const char *Symbol::c_str( void ) const { return myStr->c_str(); }
+inline bool Symbol::empty( void ) const { return myStr->empty(); }
+
+inline bool Symbol::operator==( const Symbol &o ) const { return myStr == o.myStr; }
+inline bool Symbol::operator!=( const Symbol &o ) const { return myStr != o.myStr; }
+inline bool Symbol::operator<( const Symbol &o ) const
+{
+	return myStr != o.myStr && *myStr < *(o.myStr);
+}
+
+inline bool operator==( const Symbol &a, const std::string &b ) { return a.str() == b; }
+inline bool operator==( const std::string &a, const Symbol &b ) { return a == b.str(); }
+inline bool operator==( const Symbol &a, const char *b ) { return a.str() == b; }
+inline bool operator!=( const Symbol &a, const std::string &b ) { return a.str() != b; }
+inline bool operator!=( const std::string &a, const Symbol &b ) { return a != b.str(); }
+inline bool operator!=( const Symbol &a, const char *b ) { return a.str() != b; }
+
+namespace std
+{
+
+template <>
+struct hash<Symbol>
+{
+	size_t operator()( const Symbol &s ) const
+	{
+		return std::hash<const std::string *>()( &( s.str() ) );
+	}
+};
+
+} // namespace std
+
@@ -0,0 +1,258 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+
+
+////////////////////////////////////////
+
+
+namespace
+{
+
+// 0 means use the number of hardware threads, which is filled in
+// once by the first thread asking
+static std::atomic<size_t> theThreadCount( 0 );
+static std::once_flag theDefaultCountOnce;
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+struct ThreadPool::Queue
+{
+	std::deque< std::pair< size_t, std::function<void(void)> > > tasks;
+	std::vector<std::exception_ptr> errors;
+	size_t pending = 0;
+	std::mutex mutex;
+	std::condition_variable finished;
+
+	bool runOne( void )
+	{
+		std::unique_lock<std::mutex> lk( mutex );
+		if ( tasks.empty() )
+			return false;
+
+		std::pair< size_t, std::function<void(void)> > t = std::move( tasks.front() );
+		tasks.pop_front();
+		lk.unlock();
+
+		std::exception_ptr err;
+		try
+		{
+			t.second();
+		}
+		catch ( ... )
+		{
+			err = std::current_exception();
+		}
+
+		lk.lock();
+		if ( err )
+			errors[t.first] = err;
+		if ( --pending == 0 )
+			finished.notify_all();
+		return true;
+	}
+};
+
+
+////////////////////////////////////////
+
+
+ThreadPool::ThreadPool( size_t n )
+{
+	for ( size_t i = 0; i != n; ++i )
+		myThreads.emplace_back( [this]() { workerLoop(); } );
+}
+
+
+////////////////////////////////////////
+
+
+ThreadPool::~ThreadPool( void )
+{
+	{
+		std::lock_guard<std::mutex> lk( myMutex );
+		myDone = true;
+	}
+	myCond.notify_all();
+	for ( auto &t: myThreads )
+		t.join();
+}
+
+
+////////////////////////////////////////
+
+
+void
+ThreadPool::setThreadCount( size_t n )
+{
+	theThreadCount = n;
+}
+
+
+////////////////////////////////////////
+
+
+size_t
+ThreadPool::threadCount( void )
+{
+	std::call_once( theDefaultCountOnce, []()
+	{
+		size_t unset = 0;
+		theThreadCount.compare_exchange_strong( unset, std::max( std::thread::hardware_concurrency(), 1U ) );
+	} );
+	return theThreadCount;
+}
+
+
+////////////////////////////////////////
+
+
+ThreadPool &
+ThreadPool::get( void )
+{
+	static ThreadPool thePool( threadCount() > 1 ? threadCount() : 0 );
+	return thePool;
+}
+
+
+////////////////////////////////////////
+
+
+void
+ThreadPool::schedule( const std::shared_ptr<Queue> &q )
+{
+	{
+		std::lock_guard<std::mutex> lk( myMutex );
+		myReady.push_back( q );
+	}
+	myCond.notify_one();
+}
+
+
+////////////////////////////////////////
+
+
+void
+ThreadPool::workerLoop( void )
+{
+	while ( true )
+	{
+		std::shared_ptr<Queue> q;
+		{
+			std::unique_lock<std::mutex> lk( myMutex );
+			myCond.wait( lk, [this]() { return myDone || ! myReady.empty(); } );
+			if ( myReady.empty() )
+				return;
+			q = std::move( myReady.front() );
+			myReady.pop_front();
+		}
+		// may have already been run by a thread waiting on the group
+		q->runOne();
+	}
+}
+
+
+////////////////////////////////////////
+
+
+TaskGroup::TaskGroup( void )
+		: myQueue( std::make_shared<ThreadPool::Queue>() )
+{
+}
+
+
+////////////////////////////////////////
+
+
+TaskGroup::~TaskGroup( void )
+{
+	try
+	{
+		wait( false );
+	}
+	catch ( ... )
+	{
+	}
+}
+
+
+////////////////////////////////////////
+
+
+void
+TaskGroup::run( std::function<void(void)> f )
+{
+	size_t idx;
+	{
+		std::lock_guard<std::mutex> lk( myQueue->mutex );
+		idx = myQueue->errors.size();
+		myQueue->errors.emplace_back();
+		myQueue->tasks.emplace_back( idx, std::move( f ) );
+		++myQueue->pending;
+	}
+
+	if ( ThreadPool::threadCount() > 1 )
+		ThreadPool::get().schedule( myQueue );
+	else
+		myQueue->runOne();
+}
+
+
+////////////////////////////////////////
+
+
+void
+TaskGroup::wait( bool help )
+{
+	if ( help )
+	{
+		while ( myQueue->runOne() )
+			;
+	}
+
+	std::unique_lock<std::mutex> lk( myQueue->mutex );
+	myQueue->finished.wait( lk, [this]() { return myQueue->pending == 0; } );
+
+	std::exception_ptr err;
+	for ( auto &e: myQueue->errors )
+	{
+		if ( e )
+		{
+			err = e;
+			break;
+		}
+	}
+	myQueue->errors.clear();
+	if ( err )
+		std::rethrow_exception( err );
+}
+
+
+////////////////////////////////////////
+
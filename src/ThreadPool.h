@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Class ThreadPool provides a fixed set of worker threads
+///
+/// Work is submitted through a TaskGroup. The number of threads is
+/// controlled by setThreadCount (the -j option), defaulting to the
+/// number of hardware threads. When that is 1, no threads are started
+/// and tasks are run immediately by the caller.
+///
+class ThreadPool
+{
+public:
+	~ThreadPool( void );
+
+	static void setThreadCount( size_t n );
+	static size_t threadCount( void );
+
+	static ThreadPool &get( void );
+
+private:
+	friend class TaskGroup;
+	struct Queue;
+
+	ThreadPool( size_t n );
+
+	void schedule( const std::shared_ptr<Queue> &q );
+	void workerLoop( void );
+
+	std::vector<std::thread> myThreads;
+	std::deque< std::shared_ptr<Queue> > myReady;
+	std::mutex myMutex;
+	std::condition_variable myCond;
+	bool myDone = false;
+};
+
+
+////////////////////////////////////////
+
+
+///
+/// @brief Class TaskGroup provides a set of tasks to run and wait on
+///
+/// Any exception thrown by a task is stored and re-thrown from wait,
+/// choosing the earliest task (in the order submitted) which failed
+/// so errors are reported consistently regardless of scheduling.
+///
+class TaskGroup
+{
+public:
+	TaskGroup( void );
+	~TaskGroup( void );
+	TaskGroup( const TaskGroup & ) = delete;
+	TaskGroup &operator=( const TaskGroup & ) = delete;
+
+	void run( std::function<void(void)> f );
+
+	// when help is true, the calling thread runs any tasks of this
+	// group not yet started while waiting. This must be false when
+	// the calling thread has state the tasks would disturb
+	void wait( bool help = true );
+
+private:
+	std::shared_ptr<ThreadPool::Queue> myQueue;
+};
+
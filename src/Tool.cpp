@@ -27,6 +27,7 @@
 #include "Debug.h"
 #include "StrUtil.h"
 #include "TransformSet.h"
+#include "CacheData.h"
 #include <iostream>
 #include <stdexcept>
 
@@ -398,6 +399,119 @@ Tool::createRule( const TransformSet &xset, bool useBraces ) const
 ////////////////////////////////////////
 
 
+namespace
+{
+
+static void
+putOptions( std::string &out, const Tool::OptionGroup &og )
+{
+	CacheData::put( out, static_cast<int64_t>( og.size() ) );
+	for ( auto &o: og )
+	{
+		CacheData::put( out, o.first );
+		CacheData::put( out, static_cast<int64_t>( o.second.size() ) );
+		for ( auto &c: o.second )
+		{
+			CacheData::put( out, c.first );
+			CacheData::put( out, c.second );
+		}
+	}
+}
+
+static bool
+getOptions( CacheData::Reader &rdr, Tool::OptionGroup &og )
+{
+	int64_t nOpts;
+	if ( ! rdr.get( nOpts ) )
+		return false;
+	for ( int64_t i = 0; i < nOpts; ++i )
+	{
+		std::string opt;
+		int64_t nChoices;
+		if ( ! rdr.get( opt ) || ! rdr.get( nChoices ) )
+			return false;
+		Tool::OptionSet &os = og[opt];
+		for ( int64_t c = 0; c < nChoices; ++c )
+		{
+			std::string choice;
+			if ( ! rdr.get( choice ) || ! rdr.get( os[choice] ) )
+				return false;
+		}
+	}
+	return true;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+bool
+Tool::serialize( std::string &out ) const
+{
+	if ( myExePointer )
+		return false;
+
+	CacheData::put( out, myTag );
+	CacheData::put( out, myName );
+	CacheData::put( out, myDescription );
+	CacheData::put( out, myExeName );
+	CacheData::put( out, myExtensions );
+	CacheData::put( out, myAltExtensions );
+	CacheData::put( out, myOutputPrefix );
+	CacheData::put( out, myOutputs );
+	CacheData::put( out, myCommand );
+	CacheData::put( out, myInputTools );
+	CacheData::put( out, myFlagPrefixes );
+	putOptions( out, myOptions );
+	CacheData::put( out, myOptionDefaults );
+	CacheData::put( out, myPool );
+	CacheData::put( out, static_cast<int64_t>( myOutputRestat ? 1 : 0 ) );
+	CacheData::put( out, myImplDepName );
+	CacheData::put( out, myImplDepStyle );
+	CacheData::put( out, myImplDepCmd );
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+std::shared_ptr<Tool>
+Tool::deserialize( CacheData::Reader &rdr )
+{
+	std::string tag, name;
+	if ( ! rdr.get( tag ) || ! rdr.get( name ) )
+		return std::shared_ptr<Tool>();
+
+	std::shared_ptr<Tool> ret = std::make_shared<Tool>( tag, name );
+	int64_t restat;
+	if ( ! rdr.get( ret->myDescription ) ||
+		 ! rdr.get( ret->myExeName ) ||
+		 ! rdr.get( ret->myExtensions ) ||
+		 ! rdr.get( ret->myAltExtensions ) ||
+		 ! rdr.get( ret->myOutputPrefix ) ||
+		 ! rdr.get( ret->myOutputs ) ||
+		 ! rdr.get( ret->myCommand ) ||
+		 ! rdr.get( ret->myInputTools ) ||
+		 ! rdr.get( ret->myFlagPrefixes ) ||
+		 ! getOptions( rdr, ret->myOptions ) ||
+		 ! rdr.get( ret->myOptionDefaults ) ||
+		 ! rdr.get( ret->myPool ) ||
+		 ! rdr.get( restat ) ||
+		 ! rdr.get( ret->myImplDepName ) ||
+		 ! rdr.get( ret->myImplDepStyle ) ||
+		 ! rdr.get( ret->myImplDepCmd ) )
+		return std::shared_ptr<Tool>();
+	ret->myOutputRestat = ( restat != 0 );
+	return ret;
+}
+
+
+////////////////////////////////////////
+
+
 std::shared_ptr<Tool>
 Tool::parse( const Lua::Value &v )
 {
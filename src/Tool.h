@@ -32,6 +32,7 @@
 #include "LuaValue.h"
 
 class TransformSet;
+namespace CacheData { class Reader; }
 
 
 ////////////////////////////////////////
@@ -86,6 +87,11 @@ public:
 
 	Rule createRule( const TransformSet &x, bool useBraces = false ) const;
 
+	/// binary form for the build graph cache. Tools which run an
+	/// executable built in the tree are not written (returns false)
+	bool serialize( std::string &out ) const;
+	static std::shared_ptr<Tool> deserialize( CacheData::Reader &rdr );
+
 	static std::shared_ptr<Tool> parse( const Lua::Value &v );
 	static std::shared_ptr<Tool> createInternalTool( const std::string &tag,
 													 const std::string &name,
@@ -24,6 +24,54 @@
 
 #include "Debug.h"
 #include "StrUtil.h"
+#include "CacheData.h"
+#include <algorithm>
+#include <unordered_map>
+
+
+////////////////////////////////////////
+
+namespace
+{
+
+inline size_t
+hashID( uint64_t id )
+{
+	// ids are sequential, so spread them with a fibonacci hash
+	return static_cast<size_t>( ( id * 0x9E3779B97F4A7C15ULL ) >> 32 );
+}
+
+static void
+putDir( std::string &out, CacheData::StringWriter &strings,
+		const std::shared_ptr<Directory> &d )
+{
+	CacheData::put( out, static_cast<int64_t>( d ? 1 : 0 ) );
+	if ( d )
+		strings.put( out, d->fullpath() );
+}
+
+static bool
+getDir( CacheData::Reader &rdr, const CacheData::StringReader &strings,
+		std::shared_ptr<Directory> &d,
+		std::map< std::string, std::shared_ptr<Directory> > &dirs )
+{
+	int64_t have;
+	if ( ! rdr.get( have ) )
+		return false;
+	if ( have == 0 )
+		return true;
+
+	std::string p;
+	if ( ! strings.get( rdr, p ) )
+		return false;
+	std::shared_ptr<Directory> &e = dirs[p];
+	if ( ! e )
+		e = std::make_shared<Directory>( p );
+	d = e;
+	return true;
+}
+
+} // empty namespace
 
 
 ////////////////////////////////////////
@@ -213,8 +261,7 @@ TransformSet::getOptionValue( const std::string &v ) const
 bool
 TransformSet::isTransformed( uint64_t id ) const
 {
-	auto bi = myTransformMap.find( id );
-	return bi != myTransformMap.end();
+	return findTransform( id ) != nullptr;
 }
 
 
@@ -224,9 +271,9 @@ TransformSet::isTransformed( uint64_t id ) const
 std::shared_ptr<BuildItem>
 TransformSet::getTransform( uint64_t id ) const
 {
-	auto bi = myTransformMap.find( id );
-	if ( bi != myTransformMap.end() )
-		return bi->second;
+	const TransformEntry *e = findTransform( id );
+	if ( e )
+		return e->item;
 	return std::shared_ptr<BuildItem>();
 }
 
@@ -238,8 +285,68 @@ void
 TransformSet::recordTransform( uint64_t id,
 							   const std::shared_ptr<BuildItem> &bi )
 {
+	PRECONDITION( id != 0, "Invalid item id for transform" );
 	add( bi );
-	myTransformMap[id] = bi;
+
+	if ( ( myTransformCount + 1 ) * 2 > myTransformTable.size() )
+		growTransformTable();
+
+	size_t mask = myTransformTable.size() - 1;
+	size_t i = hashID( id ) & mask;
+	while ( myTransformTable[i].id != 0 && myTransformTable[i].id != id )
+		i = ( i + 1 ) & mask;
+
+	if ( myTransformTable[i].id == 0 )
+	{
+		myTransformTable[i].id = id;
+		++myTransformCount;
+	}
+	myTransformTable[i].item = bi;
+}
+
+
+////////////////////////////////////////
+
+
+const TransformSet::TransformEntry *
+TransformSet::findTransform( uint64_t id ) const
+{
+	if ( myTransformTable.empty() )
+		return nullptr;
+
+	size_t mask = myTransformTable.size() - 1;
+	size_t i = hashID( id ) & mask;
+	while ( myTransformTable[i].id != 0 )
+	{
+		if ( myTransformTable[i].id == id )
+			return &( myTransformTable[i] );
+		i = ( i + 1 ) & mask;
+	}
+	return nullptr;
+}
+
+
+////////////////////////////////////////
+
+
+void
+TransformSet::growTransformTable( void )
+{
+	std::vector<TransformEntry> old;
+	old.swap( myTransformTable );
+	myTransformTable.resize( std::max( size_t(16), old.size() * 2 ) );
+
+	size_t mask = myTransformTable.size() - 1;
+	for ( TransformEntry &e: old )
+	{
+		if ( e.id == 0 )
+			continue;
+		size_t i = hashID( e.id ) & mask;
+		while ( myTransformTable[i].id != 0 )
+			i = ( i + 1 ) & mask;
+		myTransformTable[i].id = e.id;
+		myTransformTable[i].item = std::move( e.item );
+	}
 }
 
 
@@ -266,7 +373,247 @@ TransformSet::add( const std::vector< std::shared_ptr<BuildItem> > &items )
 ////////////////////////////////////////
 
 
+void
+TransformSet::freeze( void )
+{
+	myGraph.build( myBuildItems );
+	for ( size_t n = 0; n != myGraph.size(); ++n )
+		myGraph.item( static_cast<BuildGraph::NodeID>( n ) )->releaseDependencies();
+	std::vector<TransformEntry>().swap( myTransformTable );
+	myTransformCount = 0;
+}
+
+
+////////////////////////////////////////
+
+
+void
+TransformSet::addUsage( FlagList::Usage &u ) const
+{
+	for ( auto &v: myVars )
+		u.add( v.second.valueList() );
+	for ( auto &v: myOptions )
+		u.add( v.second.valueList() );
+	for ( size_t n = 0; n != myGraph.size(); ++n )
+	{
+		for ( auto &v: myGraph.item( static_cast<BuildGraph::NodeID>( n ) )->getVariables() )
+			u.add( v.second.valueList() );
+	}
+	for ( auto &c: myChildScopes )
+		c->addUsage( u );
+}
+
+
+////////////////////////////////////////
+
+
+bool
+TransformSet::serialize( std::string &out ) const
+{
+	// the item names, paths and flags repeat a lot (and the sub
+	// scopes share flag lists with their parents), so go in a table
+	// for the whole configuration, written ahead of everything else
+	CacheData::StringWriter strings;
+	std::string body;
+	if ( ! serializeScope( body, strings ) )
+		return false;
+
+	strings.write( out );
+	out.append( body );
+	return true;
+}
+
+
+////////////////////////////////////////
 
 
+bool
+TransformSet::deserialize( CacheData::Reader &rdr )
+{
+	CacheData::StringReader strings;
+	return strings.load( rdr ) && deserializeScope( rdr, strings );
+}
+
+
+////////////////////////////////////////
+
 
+bool
+TransformSet::serializeScope( std::string &body, CacheData::StringWriter &strings ) const
+{
+	// the tools are shared by the items, write each once and refer
+	// to them by index
+	std::vector< std::shared_ptr<Tool> > tools;
+	std::unordered_map<const Tool *, int64_t> toolIdx;
+	auto toolIndex = [&]( const std::shared_ptr<Tool> &t ) -> int64_t
+	{
+		if ( ! t )
+			return -1;
+		auto i = toolIdx.emplace( t.get(), static_cast<int64_t>( tools.size() ) );
+		if ( i.second )
+			tools.push_back( t );
+		return i.first->second;
+	};
+
+	std::vector<int64_t> setTools;
+	for ( auto &t: myTools )
+		setTools.push_back( toolIndex( t ) );
+	std::vector<int64_t> nodeTools;
+	for ( size_t n = 0; n != myGraph.size(); ++n )
+		nodeTools.push_back( toolIndex( myGraph.item( static_cast<BuildGraph::NodeID>( n ) )->getTool() ) );
+
+	CacheData::put( body, static_cast<int64_t>( tools.size() ) );
+	for ( auto &t: tools )
+	{
+		if ( ! t->serialize( body ) )
+			return false;
+	}
+	CacheData::put( body, static_cast<int64_t>( setTools.size() ) );
+	for ( int64_t t: setTools )
+		CacheData::put( body, t );
+
+	CacheData::put( body, static_cast<int64_t>( myPools.size() ) );
+	for ( auto &p: myPools )
+	{
+		CacheData::put( body, p->getName() );
+		CacheData::put( body, static_cast<int64_t>( p->getMaxJobCount() ) );
+	}
+
+	CacheData::put( body, myLibPath );
+	CacheData::put( body, myPkgPath );
+	::serialize( body, myVars, &strings );
+	::serialize( body, myOptions, &strings );
+
+	CacheData::put( body, static_cast<int64_t>( myGraph.size() ) );
+	CacheData::put( body, static_cast<int64_t>( myGraph.itemCount() ) );
+	for ( size_t n = 0; n != myGraph.size(); ++n )
+	{
+		const std::shared_ptr<BuildItem> &bi = myGraph.item( static_cast<BuildGraph::NodeID>( n ) );
+		strings.put( body, bi->getName() );
+		putDir( body, strings, bi->getDir() );
+		putDir( body, strings, bi->getOutDir() );
+		CacheData::put( body, nodeTools[n] );
+		strings.put( body, bi->getOutputs() );
+		::serialize( body, bi->getVariables(), &strings );
+		strings.put( body, bi->getTopLevelName() );
+		int64_t flags = ( bi->isTopLevelItem() ? 1 : 0 ) |
+			( bi->useName() ? 2 : 0 ) |
+			( bi->isDefaultTarget() ? 4 : 0 );
+		CacheData::put( body, flags );
+	}
+	myGraph.serialize( body );
+
+	CacheData::put( body, static_cast<int64_t>( myChildScopes.size() ) );
+	for ( auto &c: myChildScopes )
+	{
+		if ( ! c->serializeScope( body, strings ) )
+			return false;
+	}
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
+bool
+TransformSet::deserializeScope( CacheData::Reader &rdr, const CacheData::StringReader &strings )
+{
+	int64_t nTools;
+	if ( ! rdr.get( nTools ) || nTools < 0 )
+		return false;
+	std::vector< std::shared_ptr<Tool> > tools;
+	for ( int64_t t = 0; t < nTools; ++t )
+	{
+		tools.push_back( Tool::deserialize( rdr ) );
+		if ( ! tools.back() )
+			return false;
+	}
+	auto getTool = [&]( std::shared_ptr<Tool> &t ) -> bool
+	{
+		int64_t idx;
+		if ( ! rdr.get( idx ) || idx < -1 || idx >= nTools )
+			return false;
+		if ( idx >= 0 )
+			t = tools[static_cast<size_t>( idx )];
+		return true;
+	};
+
+	int64_t nSetTools;
+	if ( ! rdr.get( nSetTools ) )
+		return false;
+	for ( int64_t t = 0; t < nSetTools; ++t )
+	{
+		std::shared_ptr<Tool> tool;
+		if ( ! getTool( tool ) || ! tool )
+			return false;
+		myTools.push_back( tool );
+	}
+
+	int64_t nPools;
+	if ( ! rdr.get( nPools ) )
+		return false;
+	for ( int64_t p = 0; p < nPools; ++p )
+	{
+		std::string name;
+		int64_t jobs;
+		if ( ! rdr.get( name ) || ! rdr.get( jobs ) )
+			return false;
+		myPools.push_back( std::make_shared<Pool>( std::move( name ), static_cast<int>( jobs ) ) );
+	}
+
+	if ( ! rdr.get( myLibPath ) || ! rdr.get( myPkgPath ) ||
+		 ! ::deserialize( rdr, myVars, &strings ) ||
+		 ! ::deserialize( rdr, myOptions, &strings ) )
+		return false;
+
+	int64_t nNodes, nItems;
+	if ( ! rdr.get( nNodes ) || ! rdr.get( nItems ) || nNodes < 0 ||
+		 nItems < 0 || nItems > nNodes )
+		return false;
+
+	std::map< std::string, std::shared_ptr<Directory> > dirs;
+	std::vector< std::shared_ptr<BuildItem> > nodes;
+	nodes.reserve( static_cast<size_t>( nNodes ) );
+	for ( int64_t n = 0; n < nNodes; ++n )
+	{
+		std::string name, topName;
+		std::shared_ptr<Directory> dir, outDir;
+		std::shared_ptr<Tool> tool;
+		std::vector<std::string> outputs;
+		VariableSet vars;
+		int64_t flags;
+		if ( ! strings.get( rdr, name ) || ! getDir( rdr, strings, dir, dirs ) ||
+			 ! getDir( rdr, strings, outDir, dirs ) || ! getTool( tool ) ||
+			 ! strings.get( rdr, outputs ) || ! ::deserialize( rdr, vars, &strings ) ||
+			 ! strings.get( rdr, topName ) || ! rdr.get( flags ) )
+			return false;
+
+		std::shared_ptr<BuildItem> bi = std::make_shared<BuildItem>( std::move( name ), dir );
+		if ( tool )
+			bi->setTool( tool );
+		bi->setOutputs( outputs );
+		bi->setOutputDir( outDir );
+		bi->setVariables( std::move( vars ) );
+		bi->setTopLevel( ( flags & 1 ) != 0, topName );
+		bi->setUseName( ( flags & 2 ) != 0 );
+		bi->setDefaultTarget( ( flags & 4 ) != 0 );
+		nodes.emplace_back( std::move( bi ) );
+	}
+	myBuildItems.assign( nodes.begin(), nodes.begin() + nItems );
+	if ( ! myGraph.deserialize( rdr, std::move( nodes ), static_cast<size_t>( nItems ) ) )
+		return false;
+
+	int64_t nChildren;
+	if ( ! rdr.get( nChildren ) )
+		return false;
+	for ( int64_t c = 0; c < nChildren; ++c )
+	{
+		std::shared_ptr<TransformSet> cs = std::make_shared<TransformSet>( myDirectory, myCurrentSystem );
+		if ( ! cs->deserializeScope( rdr, strings ) )
+			return false;
+		myChildScopes.push_back( cs );
+	}
+	return true;
+}
 
@@ -32,6 +32,7 @@
 #include "Variable.h"
 #include "Directory.h"
 #include "BuildItem.h"
+#include "BuildGraph.h"
 
 
 ////////////////////////////////////////
@@ -91,7 +92,28 @@ public:
 
 	inline const BuildItemList &getBuildItems( void ) const;
 
+	/// called once the scope has been transformed to build the
+	/// compact graph and release the per-item dependencies and
+	/// transform lookup
+	void freeze( void );
+	inline const BuildGraph &getGraph( void ) const;
+
+	/// adds the storage of the variable values of the items, this and
+	/// the sub scopes for --stats
+	void addUsage( FlagList::Usage &u ) const;
+
+	/// writes a frozen transform set (and its sub scopes) for the
+	/// build graph cache, returning false if any of it can't be
+	/// written (i.e. a tool that runs an executable built in the tree)
+	bool serialize( std::string &out ) const;
+	/// restores a frozen transform set written by serialize into this
+	/// (empty) one
+	bool deserialize( CacheData::Reader &rdr );
+
 private:
+	bool serializeScope( std::string &body, CacheData::StringWriter &strings ) const;
+	bool deserializeScope( CacheData::Reader &rdr, const CacheData::StringReader &strings );
+
 	std::string myCurrentSystem;
 
 	std::shared_ptr<Directory> myDirectory;
@@ -108,7 +130,20 @@ private:
 	VariableSet myOptions;
 
 	std::vector< std::shared_ptr<BuildItem> > myBuildItems;
-	std::map< uint64_t, std::shared_ptr<BuildItem> > myTransformMap;
+
+	// every item transform starts with a lookup here, so use a
+	// flat, open addressed table keyed by item id (ids are never 0)
+	// instead of a map
+	struct TransformEntry
+	{
+		uint64_t id = 0;
+		std::shared_ptr<BuildItem> item;
+	};
+	const TransformEntry *findTransform( uint64_t id ) const;
+	void growTransformTable( void );
+	std::vector<TransformEntry> myTransformTable;
+	size_t myTransformCount = 0;
+	BuildGraph myGraph;
 
 	std::vector< std::shared_ptr<TransformSet> > myChildScopes;
 };
@@ -176,6 +211,16 @@ TransformSet::getBuildItems( void ) const
 ////////////////////////////////////////
 
 
+inline const BuildGraph &
+TransformSet::getGraph( void ) const
+{
+	return myGraph;
+}
+
+
+////////////////////////////////////////
+
+
 inline const std::vector< std::shared_ptr<TransformSet> > &
 TransformSet::getSubScopes( void ) const
 {
@@ -23,6 +23,7 @@
 #include "Variable.h"
 #include "Util.h"
 #include "Debug.h"
+#include "CacheData.h"
 #include <stdexcept>
 #include <algorithm>
 #include <cstdlib>
@@ -32,7 +33,7 @@
 
 
 Variable::Variable( std::string n, bool checkEnv )
-		: myName( std::move( n ) )
+		: myName( n )
 {
 	if ( checkEnv )
 	{
@@ -82,7 +83,7 @@ Variable::clear( void )
 {
 	myValues.clear();
 	mySystemValues.clear();
-	myCachedValue.clear();
+	myResolved.clear();
 }
 
 
@@ -93,8 +94,8 @@ void
 Variable::add( std::string v )
 {
 	if ( ! v.empty() )
-		myValues.emplace_back( std::move( v ) );
-	myCachedValue.clear();
+		myValues.push_back( std::move( v ) );
+	myResolved.clear();
 }
 
 
@@ -104,8 +105,8 @@ Variable::add( std::string v )
 void
 Variable::add( std::vector<std::string> v )
 {
-	util::append( myValues, std::move( v ) );
-	myCachedValue.clear();
+	myValues.append( std::move( v ) );
+	myResolved.clear();
 }
 
 
@@ -120,7 +121,7 @@ Variable::addPerSystem( const std::string &s, std::string v )
 
 	std::vector<std::string> &sE = mySystemValues[s];
 	sE.emplace_back( std::move( v ) );
-	myCachedValue.clear();
+	myResolved.clear();
 }
 
 
@@ -132,7 +133,7 @@ Variable::addPerSystem( const std::string &s, std::vector<std::string> v )
 {
 	std::vector<std::string> &sE = mySystemValues[s];
 	util::append( sE, std::move( v ) );
-	myCachedValue.clear();
+	myResolved.clear();
 }
 
 
@@ -142,17 +143,8 @@ Variable::addPerSystem( const std::string &s, std::vector<std::string> v )
 void
 Variable::addIfMissing( const std::string &v )
 {
-	if ( v.empty() )
-		return;
-
-	for ( const std::string &i: myValues )
-	{
-		if ( i == v )
-			return;
-	}
-
-	myValues.push_back( v );
-	myCachedValue.clear();
+	if ( myValues.addIfMissing( v ) )
+		myResolved.clear();
 }
 
 
@@ -162,8 +154,8 @@ Variable::addIfMissing( const std::string &v )
 void
 Variable::addIfMissing( const std::vector<std::string> &v )
 {
-	for ( const std::string &i: v )
-		addIfMissing( i );
+	myValues.addIfMissing( v );
+	myResolved.clear();
 }
 
 
@@ -184,7 +176,7 @@ Variable::addIfMissingSystem( const std::string &s, const std::string &v )
 	}
 
 	sE.push_back( std::move( v ) );
-	myCachedValue.clear();
+	myResolved.clear();
 }
 
 
@@ -208,23 +200,19 @@ Variable::moveToEnd( const std::string &v )
 	if ( v.empty() )
 		return;
 
-	auto i = myValues.begin();
-	while ( true )
-	{
-		if ( i == myValues.end() )
-			break;
+	myValues.moveToEnd( v );
+	myResolved.clear();
+}
+
+
+////////////////////////////////////////
 
-		if ( (*i) == v )
-		{
-			myValues.erase( i );
-			i = myValues.begin();
-			continue;
-		}
-		++i;
-	}
 
-	myValues.push_back( v );
-	myCachedValue.clear();
+void
+Variable::moveToEnd( const std::vector<std::string> &v )
+{
+	myValues.moveToEnd( v );
+	myResolved.clear();
 }
 
 
@@ -232,10 +220,10 @@ Variable::moveToEnd( const std::string &v )
 
 
 void
-Variable::moveToEnd( const std::vector<std::string> &v )
+Variable::moveToEnd( const Variable &other )
 {
-	for ( const std::string &i: v )
-		moveToEnd( i );
+	myValues.moveToEnd( other.myValues );
+	myResolved.clear();
 }
 
 
@@ -245,27 +233,8 @@ Variable::moveToEnd( const std::vector<std::string> &v )
 void
 Variable::removeDuplicatesKeepLast( void )
 {
-	// O(n^2) but it's simple
-	for ( size_t i = 0; i != myValues.size(); ++i )
-	{
-		bool kill = false;
-		const std::string &cur = myValues[i];
-		for ( size_t j = i + 1; j < myValues.size(); ++j )
-		{
-			if ( myValues[j] == cur )
-			{
-				kill = true;
-				break;
-			}
-		}
-
-		if ( kill )
-		{
-			typedef typename std::vector<std::string>::iterator::difference_type dt_t;
-			myValues.erase( myValues.begin() + static_cast<dt_t>( i ) );
-			--i;
-		}
-	}
+	myValues.removeDuplicatesKeepLast();
+	myResolved.clear();
 }
 
 
@@ -275,58 +244,8 @@ Variable::removeDuplicatesKeepLast( void )
 void
 Variable::removeDuplicates( const std::map<std::string, bool> &prefixDisposition )
 {
-	typedef typename std::vector<std::string>::iterator::difference_type dt_t;
-
-	// O(n^2) but it's simple
-	for ( size_t i = 0; i < myValues.size(); ++i )
-	{
-		const std::string &cur = myValues[i];
-		bool inPref = false;
-		bool first = true;
-		for ( auto &x: prefixDisposition )
-		{
-			if ( cur.compare( 0, x.first.size(), x.first ) == 0 )
-			{
-				inPref = true;
-				first = x.second;
-				break;
-			}
-		}
-		// entry doesn't have a desired prefix,
-		// skip this one
-		if ( ! inPref )
-			continue;
-
-		if ( first )
-		{
-			for ( size_t j = i + 1; j < myValues.size(); ++j )
-			{
-				if ( myValues[j] == cur )
-				{
-					myValues.erase( myValues.begin() + static_cast<dt_t>( j ) );
-					--j;
-				}
-			}
-		}
-		else
-		{
-			bool kill = false;
-			for ( size_t j = i + 1; j < myValues.size(); ++j )
-			{
-				if ( myValues[j] == cur )
-				{
-					kill = true;
-					break;
-				}
-			}
-
-			if ( kill )
-			{
-				myValues.erase( myValues.begin() + static_cast<dt_t>( i ) );
-				--i;
-			}
-		}
-	}
+	myValues.removeDuplicates( prefixDisposition );
+	myResolved.clear();
 }
 
 
@@ -338,7 +257,7 @@ Variable::reset( std::string v )
 {
 	clear();
 	if ( ! v.empty() )
-		myValues.emplace_back( std::move( v ) );
+		myValues.push_back( std::move( v ) );
 }
 
 
@@ -347,6 +266,17 @@ Variable::reset( std::string v )
 
 void
 Variable::reset( std::vector<std::string> v )
+{
+	clear();
+	myValues.assign( std::move( v ) );
+}
+
+
+////////////////////////////////////////
+
+
+void
+Variable::reset( FlagList v )
 {
 	clear();
 	myValues = std::move( v );
@@ -359,12 +289,11 @@ Variable::reset( std::vector<std::string> v )
 void
 Variable::merge( const Variable &other )
 {
-	addIfMissing( other.myValues );
+	addIfMissing( other.myValues.values() );
 	for ( auto i: other.mySystemValues )
 		addIfMissingSystem( i.first, i.second );
 
-	myCachedValue.clear();
-	myCachedSystem.clear();
+	myResolved.clear();
 }
 
 
@@ -374,64 +303,47 @@ Variable::merge( const Variable &other )
 const std::string &
 Variable::value( const std::string &sys ) const
 {
-	if ( ! myCachedValue.empty() && sys == myCachedSystem )
-		return myCachedValue;
-
-	myCachedValue.clear();
-	if ( myInherit )
-		myCachedValue = "$" + myName;
-	
-	for ( const auto &i: myValues )
-	{
-		if ( i.empty() )
-			continue;
-		if ( ! myCachedValue.empty() )
-			myCachedValue.push_back( ' ' );
-		myCachedValue.append( i );
-	}
-
-	auto x = mySystemValues.find( sys );
-	if ( x != mySystemValues.end() )
-	{
-		for ( const auto &i: x->second )
-		{
-			if ( i.empty() )
-				continue;
-			if ( ! myCachedValue.empty() )
-				myCachedValue.push_back( ' ' );
-			myCachedValue.append( i );
-		}
-	}
-	myCachedSystem = sys;
-	return myCachedValue;
+	return prepended_value( std::string(), sys );
 }
 
 
 ////////////////////////////////////////
 
 
-std::string
+const std::string &
 Variable::prepended_value( const std::string &prefix, const std::string &sys ) const
 {
-	std::string ret;
-	if ( myInherit )
-		ret = "$" + myName;
-	
-	for ( const auto &i: myValues )
+	auto x = mySystemValues.find( sys );
+	if ( x != mySystemValues.end() && x->second.empty() )
+		x = mySystemValues.end();
+
+	// usually it is only the list, which shares the join with the
+	// copies of it
+	if ( ! myInherit && x == mySystemValues.end() )
+		return myValues.joined( prefix );
+
+	for ( const Resolved &r: myResolved )
 	{
-		if ( i.empty() )
-			continue;
+		if ( r.system == sys && r.prefix == prefix )
+			return r.text;
+	}
 
+	myResolved.emplace_front();
+	Resolved &r = myResolved.front();
+	r.prefix = prefix;
+	r.system = sys;
+	std::string &ret = r.text;
+	if ( myInherit )
+		ret = "$" + myName.str();
+
+	const std::string &vals = myValues.joined( prefix );
+	if ( ! vals.empty() )
+	{
 		if ( ! ret.empty() )
 			ret.push_back( ' ' );
-
-		if ( i.find( prefix ) != 0 )
-			ret.append( prefix );
-
-		ret.append( i );
+		ret.append( vals );
 	}
 
-	auto x = mySystemValues.find( sys );
 	if ( x != mySystemValues.end() )
 	{
 		for ( const auto &i: x->second )
@@ -468,19 +380,77 @@ Variable::nil( void )
 
 
 
+VariableSet::iterator
+VariableSet::find( const std::string &n )
+{
+	auto i = std::lower_bound( myItems.begin(), myItems.end(), n,
+							   []( const value_type &v, const std::string &k ) { return v.first < k; } );
+	if ( i != myItems.end() && i->first == n )
+		return i;
+	return myItems.end();
+}
+
+
+////////////////////////////////////////
+
+
+VariableSet::const_iterator
+VariableSet::find( const std::string &n ) const
+{
+	auto i = std::lower_bound( myItems.begin(), myItems.end(), n,
+							   []( const value_type &v, const std::string &k ) { return v.first < k; } );
+	if ( i != myItems.end() && i->first == n )
+		return i;
+	return myItems.end();
+}
+
+
+////////////////////////////////////////
+
+
+std::pair<VariableSet::iterator, bool>
+VariableSet::emplace( value_type v )
+{
+	// the sets read from the caches and copied from others come in
+	// order
+	if ( myItems.empty() || myItems.back().first < v.first )
+	{
+		myItems.emplace_back( std::move( v ) );
+		return std::make_pair( myItems.end() - 1, true );
+	}
+
+	auto i = std::lower_bound( myItems.begin(), myItems.end(), v.first,
+							   []( const value_type &x, const std::string &k ) { return x.first < k; } );
+	if ( i->first == v.first )
+		return std::make_pair( i, false );
+	return std::make_pair( myItems.insert( i, std::move( v ) ), true );
+}
+
+
+////////////////////////////////////////
+
+
+VariableSet::iterator
+VariableSet::erase( iterator i )
+{
+	return myItems.erase( i );
+}
+
+
+////////////////////////////////////////
+
+
 void merge( VariableSet &vs, const VariableSet &other )
 {
 	if ( vs.empty() )
 		vs = other;
 	else
 	{
-		for ( auto i: other )
+		for ( const auto &i: other )
 		{
 			auto cur = vs.find( i.first );
 			if ( cur == vs.end() )
-			{
-				vs.emplace( std::make_pair( i.first, i.second ) );
-			}
+				vs.emplace( i );
 			else
 				cur->second.merge( i.second );
 		}
@@ -491,6 +461,115 @@ void merge( VariableSet &vs, const VariableSet &other )
 ////////////////////////////////////////
 
 
+void serialize( std::string &out, const VariableSet &vs,
+				CacheData::StringWriter *strings )
+{
+	auto putStr = [&]( const std::string &v )
+	{
+		if ( strings )
+			strings->put( out, v );
+		else
+			CacheData::put( out, v );
+	};
+	auto putList = [&]( const std::vector<std::string> &v )
+	{
+		if ( strings )
+			strings->put( out, v );
+		else
+			CacheData::put( out, v );
+	};
+	// the values propagated to the objects are shared, so write those
+	// once for the table and share them again when read
+	auto putValues = [&]( const FlagList &v )
+	{
+		if ( ! strings || strings->putShared( out, v.storage() ) )
+			putList( v.values() );
+	};
+
+	CacheData::put( out, static_cast<int64_t>( vs.size() ) );
+	for ( const auto &v: vs )
+	{
+		putStr( v.first );
+		CacheData::put( out, static_cast<int64_t>( v.second.inherit() ? 1 : 0 ) );
+		putStr( v.second.getToolTag() );
+		putValues( v.second.valueList() );
+		CacheData::put( out, static_cast<int64_t>( v.second.system_values().size() ) );
+		for ( const auto &sv: v.second.system_values() )
+		{
+			putStr( sv.first );
+			putList( sv.second );
+		}
+	}
+}
+
+
+////////////////////////////////////////
+
+
+bool deserialize( CacheData::Reader &rdr, VariableSet &vs,
+				  const CacheData::StringReader *strings )
+{
+	auto getStr = [&]( std::string &v ) -> bool
+	{
+		return strings ? strings->get( rdr, v ) : rdr.get( v );
+	};
+	auto getList = [&]( std::vector<std::string> &v ) -> bool
+	{
+		return strings ? strings->get( rdr, v ) : rdr.get( v );
+	};
+
+	int64_t n;
+	if ( ! rdr.get( n ) )
+		return false;
+	for ( int64_t i = 0; i < n; ++i )
+	{
+		std::string name, tag;
+		int64_t inherit, nSys;
+		if ( ! getStr( name ) || ! rdr.get( inherit ) || ! getStr( tag ) )
+			return false;
+
+		FlagList vals;
+		std::shared_ptr<void> *shared = nullptr;
+		bool isNew = true;
+		if ( strings && ! strings->getShared( rdr, shared, isNew ) )
+			return false;
+		if ( isNew )
+		{
+			std::vector<std::string> l;
+			if ( ! getList( l ) )
+				return false;
+			vals.assign( std::move( l ) );
+			if ( shared )
+				*shared = std::make_shared<FlagList>( vals );
+		}
+		else if ( *shared )
+			vals = *static_cast<const FlagList *>( shared->get() );
+		else
+			return false;
+		if ( ! rdr.get( nSys ) )
+			return false;
+
+		Variable v( name );
+		v.inherit( inherit != 0 );
+		v.setToolTag( std::move( tag ) );
+		v.reset( std::move( vals ) );
+		for ( int64_t s = 0; s < nSys; ++s )
+		{
+			std::string sys;
+			std::vector<std::string> sysVals;
+			if ( ! getStr( sys ) || ! getList( sysVals ) )
+				return false;
+			v.addPerSystem( sys, std::move( sysVals ) );
+		}
+		vs.emplace( std::make_pair( std::move( name ), std::move( v ) ) );
+	}
+	return true;
+}
+
+
+////////////////////////////////////////
+
+
 
 
 
@@ -25,6 +25,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <forward_list>
+#include "Symbol.h"
+#include "FlagList.h"
 
 
 ////////////////////////////////////////
@@ -66,6 +69,7 @@ public:
 	void addIfMissingSystem( const std::string &s, const std::vector<std::string> &v );
 	void moveToEnd( const std::string &v );
 	void moveToEnd( const std::vector<std::string> &v );
+	void moveToEnd( const Variable &other );
 	// removes duplicates, keeping last entry
 	// does NOT change relative ordering
 	void removeDuplicatesKeepLast( void );
@@ -81,29 +85,43 @@ public:
 
 	void reset( std::string v );
 	void reset( std::vector<std::string> v );
+	void reset( FlagList v );
 
 	// adds any values in other not in current
 	void merge( const Variable &other );
 
+	// the values are joined once per system (and prefix), the
+	// returned value stays valid until the variable is changed
 	const std::string &value( const std::string &sys ) const;
 
 	// if any of the values in the Variable don't begin
 	// with the provided prefix, it is preprended to that
 	// value.
-	std::string prepended_value( const std::string &prefix, const std::string &sys ) const;
+	const std::string &prepended_value( const std::string &prefix, const std::string &sys ) const;
 
 	inline const std::vector<std::string> &values( void ) const;
+	inline const FlagList &valueList( void ) const;
 	inline const std::map<std::string, std::vector<std::string>> &system_values( void ) const;
 
 	static const Variable &nil( void );
 private:
 	std::string replace_vars( const std::string &v );
 
-	std::string myName;
-	std::vector<std::string> myValues;
+	// values that aren't just the joined list, as the variable is
+	// inherited or has values for the system. Each configuration is
+	// transformed in to its own copies, so these are only used from
+	// one thread
+	struct Resolved
+	{
+		std::string prefix;
+		std::string system;
+		std::string text;
+	};
+
+	Symbol myName;
+	FlagList myValues;
 	std::map<std::string, std::vector<std::string>> mySystemValues;
-	mutable std::string myCachedValue;
-	mutable std::string myCachedSystem;
+	mutable std::forward_list<Resolved> myResolved;
 	std::string myToolTag;
 	bool myInherit = false;
 };
@@ -126,10 +144,64 @@ inline bool operator!=( const Variable &a, const Variable &b )
 	return !( a == b );
 }
 
-typedef std::map<std::string, Variable> VariableSet;
+
+////////////////////////////////////////
+
+
+///
+/// @brief Class VariableSet provides the variables of a scope or item
+///        by name, in name order.
+///
+/// Most sets hold a handful of variables and are copied to each item
+/// transformed, so they are kept sorted in one vector and binary
+/// searched instead of being a tree with a node per variable. Adding
+/// or erasing a variable invalidates the iterators and references.
+///
+class VariableSet
+{
+public:
+	typedef std::pair<std::string, Variable> value_type;
+	typedef std::vector<value_type>::iterator iterator;
+	typedef std::vector<value_type>::const_iterator const_iterator;
+
+	inline iterator begin( void ) { return myItems.begin(); }
+	inline iterator end( void ) { return myItems.end(); }
+	inline const_iterator begin( void ) const { return myItems.begin(); }
+	inline const_iterator end( void ) const { return myItems.end(); }
+
+	inline bool empty( void ) const { return myItems.empty(); }
+	inline size_t size( void ) const { return myItems.size(); }
+	inline void clear( void ) { myItems.clear(); }
+
+	iterator find( const std::string &n );
+	const_iterator find( const std::string &n ) const;
+
+	// as std::map, does nothing if there is a variable with the name
+	std::pair<iterator, bool> emplace( value_type v );
+	template <typename K>
+	inline std::pair<iterator, bool> emplace( std::pair<K, Variable> &&v )
+	{
+		return emplace( value_type( std::move( v.first ), std::move( v.second ) ) );
+	}
+	iterator erase( iterator i );
+
+	inline bool operator==( const VariableSet &o ) const { return myItems == o.myItems; }
+	inline bool operator!=( const VariableSet &o ) const { return myItems != o.myItems; }
+
+private:
+	std::vector<value_type> myItems;
+};
 
 void merge( VariableSet &vs, const VariableSet &other );
 
+namespace CacheData { class Reader; class StringWriter; class StringReader; }
+/// binary form of a variable set for the caches, optionally with the
+/// names and values in a string table
+void serialize( std::string &out, const VariableSet &vs,
+				CacheData::StringWriter *strings = nullptr );
+bool deserialize( CacheData::Reader &rdr, VariableSet &vs,
+				  const CacheData::StringReader *strings = nullptr );
+
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -137,7 +209,7 @@ void merge( VariableSet &vs, const VariableSet &other );
 inline const std::string &
 Variable::name( void ) const
 {
-	return myName;
+	return myName.str();
 }
 
 
@@ -178,6 +250,16 @@ Variable::empty( void ) const
 
 inline const std::vector<std::string> &
 Variable::values( void ) const
+{
+	return myValues.values();
+}
+
+
+////////////////////////////////////////
+
+
+inline const FlagList &
+Variable::valueList( void ) const
 {
 	return myValues;
 }
@@ -29,18 +29,25 @@
 #include <fstream>
 #include <iomanip>
 #include <string.h>
+#include <stdlib.h>
+#include <algorithm>
 #include "Debug.h"
 #include "LuaExtensions.h"
 #include "Directory.h"
 #include "Compile.h"
 #include "Scope.h"
 #include "PackageConfig.h"
+#include "PackageSet.h"
 #include "Configuration.h"
 #include "Generator.h"
 #include "NinjaGenerator.h"
 #include "MakeGenerator.h"
 #include "CodeGenerator.h"
 #include "Version.h"
+#include "ThreadPool.h"
+#include "GlobManifest.h"
+#include "GraphCache.h"
+#include "Daemon.h"
 
 
 ////////////////////////////////////////
@@ -72,6 +79,15 @@ usageAndExit( const char *argv0, int es )
 		" -G|--generator    Specifies which generator to use\n"
 		" --show-generators Displays a list of generators and exits\n"
 		" --verbose         Displays messages as the build tree is processed\n"
+		" --stats           Displays the memory used by the transformed build graph\n"
+		" --no-bytecode-cache Disables caching compiled construct files in the build tree\n"
+		" --no-graph-cache  Evaluates the construct files even when the build graph of the last\n"
+		"                   run with the same arguments is still up to date\n"
+		" -j|--jobs <N>     Number of threads to use (defaults to the number of cores)\n"
+		" --parallel-subprojects Evaluates subprojects in parallel, each with separate lua globals\n"
+		" --daemon          Stays running, regenerating the build files as the sources change\n"
+		" --regen           Used by the generated build files, skips regenerating when only\n"
+		"                   files no glob matches were added or removed\n"
 #ifndef NDEBUG
 		" -d|--debug        Displays debugging messages\n"
 #endif
@@ -98,6 +114,7 @@ emitWrapper( Directory &srcDir,
 {
 	std::string wrapper = srcDir.makefilename( "Makefile" );
 	std::ofstream wf( wrapper );
+	File::invalidateStatCache( wrapper );
 
 	if ( doConfigDir )
 	{
@@ -144,7 +161,9 @@ emitWrapper( Directory &srcDir,
 		for ( int a = 1; a < argc; ++a )
 		{
 			std::string arg = argv[a];
-			if ( arg == "-emit-wrapper" || arg == "--emit-wrapper" )
+			if ( arg == "-emit-wrapper" || arg == "--emit-wrapper" ||
+				 arg == "-regen" || arg == "--regen" ||
+				 arg == "-daemon" || arg == "--daemon" )
 				continue;
 			wf << ' ' << argv[a];
 		}
@@ -213,6 +232,9 @@ main( int argc, const char *argv[] )
 	try
 	{
 		File::setArgv0( argv[0] );
+		// set before anything searches for programs, so those
+		// searches can use what the last run found
+		File::setCacheDirectory( Directory::current()->makefilename( ".constructor" ) );
 
 		NinjaGenerator::init();
 		MakeGenerator::init();
@@ -222,6 +244,8 @@ main( int argc, const char *argv[] )
 		std::shared_ptr<Generator> generator;
 		bool doConfigDir = true;
 		bool doWrapper = false;
+		bool regenCheck = false;
+		bool runDaemon = false;
 
 		bool generateCode = false;
 		std::string generateOutputName;
@@ -266,6 +290,18 @@ main( int argc, const char *argv[] )
 					continue;
 				}
 
+				if ( tmp == "regen" )
+				{
+					regenCheck = true;
+					continue;
+				}
+
+				if ( tmp == "daemon" )
+				{
+					runDaemon = true;
+					continue;
+				}
+
 #ifndef NDEBUG
 				if ( tmp == "d" || tmp == "debug" )
 				{
@@ -279,6 +315,12 @@ main( int argc, const char *argv[] )
 					continue;
 				}
 
+				if ( tmp == "stats" )
+				{
+					Stats::enable( true );
+					continue;
+				}
+
 				if ( tmp == "v" || tmp == "version" )
 				{
 					std::cout << "constructor " << Constructor::version() << std::endl;
@@ -291,6 +333,36 @@ main( int argc, const char *argv[] )
 					continue;
 				}
 
+				if ( tmp == "no-bytecode-cache" )
+				{
+					Lua::Engine::singleton().setBytecodeCache( false );
+					continue;
+				}
+
+				if ( tmp == "no-graph-cache" )
+				{
+					GraphCache::disable();
+					continue;
+				}
+
+				if ( tmp == "parallel-subprojects" )
+				{
+					Lua::setParallelSubProjects( true );
+					continue;
+				}
+
+				if ( tmp == "j" || tmp == "jobs" )
+				{
+					if ( ( i + 1 ) >= argc )
+					{
+						std::cerr << "ERROR: Missing argument for jobs" << std::endl;
+						usageAndExit( argv[0], 1 );
+					}
+					++i;
+					ThreadPool::setThreadCount( static_cast<size_t>( std::max( atoi( argv[i] ), 1 ) ) );
+					continue;
+				}
+
 				if ( tmp == "embed_binary_cstring" )
 				{
 					generateCode = true;
@@ -403,6 +475,47 @@ main( int argc, const char *argv[] )
 			return 0;
 		}
 
+		// the build files re-run us with --regen, which first checks
+		// whether anything the build files depend on really changed
+		// since the last run with the same arguments (ignoring those
+		// that only change the messages)
+		std::vector<const char *> regenArgv{ argv[0], "--regen" };
+		std::string cmdline = argv[0];
+		// the build graph is the same for any generator
+		std::string graphCmdline = argv[0];
+		bool generatorArg = false;
+		for ( int a = 1; a < argc; ++a )
+		{
+			std::string arg = argv[a];
+			if ( arg == "--regen" || arg == "-regen" ||
+				 arg == "--daemon" || arg == "-daemon" )
+				continue;
+			regenArgv.push_back( argv[a] );
+			if ( arg == "--verbose" || arg == "-verbose" ||
+				 arg == "--stats" || arg == "-stats" ||
+				 arg == "-q" || arg == "--quiet" || arg == "-quiet" ||
+				 arg == "-d" || arg == "--debug" || arg == "-debug" )
+				continue;
+			cmdline.push_back( ' ' );
+			cmdline.append( arg );
+			if ( generatorArg )
+			{
+				generatorArg = false;
+				continue;
+			}
+			if ( arg == "-G" || arg == "--G" || arg == "-generator" || arg == "--generator" )
+			{
+				generatorArg = true;
+				continue;
+			}
+			graphCmdline.push_back( ' ' );
+			graphCmdline.append( arg );
+		}
+		const int regenArgc = static_cast<int>( regenArgv.size() );
+
+		if ( regenCheck && ( Daemon::request( cmdline ) || GlobManifest::upToDate( cmdline ) ) )
+			return 0;
+
 		if ( ! generator )
 		{
 			const auto &a = Generator::available();
@@ -412,12 +525,15 @@ main( int argc, const char *argv[] )
 //			std::cout << "Using default generator: " << generator->name() << std::endl;
 		}
 
-		Lua::registerExtensions();
-		Lua::startParsing( subdir );
-
-		for ( const Configuration &c: Configuration::defined() )
+		auto generate = [&]( void ) -> int
 		{
-			if ( config.empty() || c.name() == config )
+			if ( ! GraphCache::load( graphCmdline, config ) )
+			{
+				Lua::registerExtensions();
+				Lua::startParsing( subdir );
+			}
+
+			auto emitConfig = [&]( const Configuration &c )
 			{
 				std::shared_ptr<Directory> outDir = Directory::current();
 				if ( doConfigDir )
@@ -425,19 +541,48 @@ main( int argc, const char *argv[] )
 					outDir = Directory::pushd( c.name() );
 					ON_EXIT{ Directory::popd(); };
 					outDir->mkpath();
-					generator->emit( outDir, c, argc, argv );
+					generator->emit( outDir, c, regenArgc, regenArgv.data() );
 				}
 				else
-					generator->emit( outDir, c, argc, argv );
+					generator->emit( outDir, c, regenArgc, regenArgv.data() );
+			};
+
+			// the configurations only read the evaluated tree, so can be
+			// transformed and emitted at the same time
+			TaskGroup configTasks;
+			for ( const Configuration &c: Configuration::defined() )
+			{
+				if ( config.empty() || c.name() == config )
+				{
+					if ( ThreadPool::threadCount() > 1 )
+					{
+						const Configuration *cp = &c;
+						configTasks.run( [=]() { emitConfig( *cp ); } );
+					}
+					else
+						emitConfig( c );
+				}
 			}
-		}
+			configTasks.wait();
+			PackageSet::writeCaches();
+			File::writeExecutableCache();
+			GlobManifest::write( cmdline );
+			GraphCache::write();
 
-		if ( doWrapper )
-		{
-			Directory srcDir;
-			srcDir.cd( subdir );
-			emitWrapper( srcDir, generator, doConfigDir, argc, argv );
-		}
+			if ( doWrapper )
+			{
+				Directory srcDir;
+				srcDir.cd( subdir );
+				emitWrapper( srcDir, generator, doConfigDir, argc, argv );
+			}
+
+			File::reportStatCache();
+			return 0;
+		};
+
+		if ( runDaemon )
+			return Daemon::run( cmdline, generate );
+		return generate();
 	}
 	catch ( std::exception &e )
 	{
@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "FileUtil.h"
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+////////////////////////////////////////
+
+
+// File::find answers from cached directory listings, which must still
+// find names with directories in them, as in require "sub/helper"
+
+namespace
+{
+
+int theFailures = 0;
+
+#define CHECK( x ) \
+	do { if ( ! ( x ) ) { std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #x << std::endl; ++theFailures; } } while ( 0 )
+
+void
+touch( const std::string &fn )
+{
+	std::ofstream f( fn );
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+int
+main( void )
+{
+	char tmpl[] = "/tmp/constructor-find-XXXXXX";
+	if ( ! mkdtemp( tmpl ) )
+	{
+		std::cerr << "Unable to create a temporary directory" << std::endl;
+		return 1;
+	}
+	const std::string root = tmpl;
+	const std::string mods = root + "/mods";
+	const std::string other = root + "/other";
+	mkdir( mods.c_str(), 0755 );
+	mkdir( ( mods + "/sub" ).c_str(), 0755 );
+	mkdir( other.c_str(), 0755 );
+	touch( mods + "/top.construct" );
+	touch( mods + "/sub/helper.construct" );
+
+	const std::vector<std::string> path{ other, mods };
+	std::string fp;
+
+	CHECK( File::find( fp, "top.construct", path ) );
+	CHECK( fp == mods + "/top.construct" );
+	fp.clear();
+	CHECK( File::find( fp, "sub/helper.construct", path ) );
+	CHECK( fp == mods + "/sub/helper.construct" );
+	CHECK( File::find( fp, "sub", path ) );
+	CHECK( ! File::find( fp, "sub/missing.construct", path ) );
+	CHECK( ! File::find( fp, "nosuch/helper.construct", path ) );
+
+	fp.clear();
+	CHECK( File::find( fp, "sub/helper", { ".lua", ".construct" }, path ) );
+	CHECK( fp == mods + "/sub/helper.construct" );
+	fp.clear();
+	CHECK( File::find( fp, "top", { ".construct" }, path ) );
+	CHECK( fp == mods + "/top.construct" );
+	CHECK( ! File::find( fp, "sub/top", { ".construct" }, path ) );
+
+	unlink( ( mods + "/sub/helper.construct" ).c_str() );
+	unlink( ( mods + "/top.construct" ).c_str() );
+	rmdir( ( mods + "/sub" ).c_str() );
+	rmdir( mods.c_str() );
+	rmdir( other.c_str() );
+	rmdir( root.c_str() );
+
+	return theFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "FlagList.h"
+#include "VectorFlags.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+
+////////////////////////////////////////
+
+
+// Runs random sequences of operations on a FlagList and on a plain
+// vector using the operations it replaced, checking after each step
+// that the values (and membership) are identical, and that copies
+// taken before the step were not changed through the shared storage.
+// The values come from a small set so duplicates are common, and the
+// lists grow past the size where FlagList starts indexing.
+
+namespace
+{
+
+typedef VectorFlags::List List;
+
+class Check
+{
+public:
+	Check( unsigned seed ) : myRNG( seed ) {}
+
+	bool run( size_t sequences, size_t steps );
+
+private:
+	size_t pick( size_t n ) { return static_cast<size_t>( myRNG() % n ); }
+	std::string value( void );
+	List values( void );
+	void step( FlagList &f, List &r );
+	bool fail( const char *what, size_t seq, size_t s );
+
+	std::mt19937 myRNG;
+	size_t myRange = 1;
+};
+
+std::string
+Check::value( void )
+{
+	static const char *thePrefixes[] = { "-I", "-D", "-l", "x" };
+	size_t k = pick( myRange );
+	// the empty value is ignored by the adds and moves
+	if ( k == 0 )
+		return std::string();
+	return std::string( thePrefixes[k % 4] ) + std::to_string( k );
+}
+
+List
+Check::values( void )
+{
+	List ret;
+	size_t n = pick( 40 );
+	for ( size_t i = 0; i != n; ++i )
+		ret.push_back( value() );
+	return ret;
+}
+
+void
+Check::step( FlagList &f, List &r )
+{
+	switch ( pick( 10 ) )
+	{
+		case 0:
+		{
+			std::string v = value();
+			if ( ! v.empty() )
+			{
+				r.push_back( v );
+				f.push_back( v );
+			}
+			break;
+		}
+		case 1:
+		{
+			List v = values();
+			r.insert( r.end(), v.begin(), v.end() );
+			f.append( v );
+			break;
+		}
+		case 2:
+		{
+			std::string v = value();
+			VectorFlags::addIfMissing( r, v );
+			f.addIfMissing( v );
+			break;
+		}
+		case 3:
+		{
+			List v = values();
+			for ( const std::string &i: v )
+				VectorFlags::addIfMissing( r, i );
+			f.addIfMissing( v );
+			break;
+		}
+		case 4:
+		{
+			std::string v = value();
+			VectorFlags::moveToEnd( r, v );
+			f.moveToEnd( v );
+			break;
+		}
+		case 5:
+		{
+			List v = values();
+			for ( const std::string &i: v )
+				VectorFlags::moveToEnd( r, i );
+			f.moveToEnd( v );
+			break;
+		}
+		case 6:
+		{
+			// a list built up by adds is indexed, an assigned one
+			// isn't until it's looked in
+			List v = values();
+			FlagList o;
+			if ( pick( 2 ) )
+				o.assign( v );
+			else
+			{
+				for ( const std::string &i: v )
+					o.push_back( i );
+				o.contains( "-Ix" );
+			}
+			for ( const std::string &i: v )
+				VectorFlags::moveToEnd( r, i );
+			f.moveToEnd( o );
+			break;
+		}
+		case 7:
+			VectorFlags::removeDuplicatesKeepLast( r );
+			f.removeDuplicatesKeepLast();
+			break;
+		case 8:
+		{
+			std::map<std::string, bool> pd{ { "-I", true }, { "-D", true }, { "-l", false } };
+			if ( pick( 3 ) == 0 )
+				pd[std::string()] = pick( 2 ) != 0;
+			VectorFlags::removeDuplicates( r, pd );
+			f.removeDuplicates( pd );
+			break;
+		}
+		case 9:
+		{
+			List v = values();
+			r = v;
+			f.assign( std::move( v ) );
+			break;
+		}
+	}
+}
+
+bool
+Check::fail( const char *what, size_t seq, size_t s )
+{
+	std::cerr << what << " differs at sequence " << seq << " step " << s << std::endl;
+	return false;
+}
+
+bool
+Check::run( size_t sequences, size_t steps )
+{
+	for ( size_t seq = 0; seq != sequences; ++seq )
+	{
+		myRange = 1 + pick( 60 );
+		FlagList f;
+		List r;
+		for ( size_t s = 0; s != steps; ++s )
+		{
+			FlagList copy = f;
+			List copyValues = f.values();
+
+			step( f, r );
+
+			if ( f.values() != r )
+				return fail( "values", seq, s );
+			if ( copy.values() != copyValues )
+				return fail( "copy", seq, s );
+			if ( f.size() != r.size() || f.empty() != r.empty() )
+				return fail( "size", seq, s );
+			for ( size_t q = 0; q != 5; ++q )
+			{
+				std::string v = value();
+				bool have = std::find( r.begin(), r.end(), v ) != r.end();
+				if ( ! v.empty() && f.contains( v ) != have )
+					return fail( "contains", seq, s );
+			}
+		}
+	}
+	return true;
+}
+
+} // empty namespace
+
+
+////////////////////////////////////////
+
+
+int
+main( void )
+{
+	Check c( 1 );
+	return c.run( 20000, 30 ) ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2016 Kimball Thurston
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+
+////////////////////////////////////////
+
+
+///
+/// The list operations Variable used before FlagList, scanning (and
+/// erasing from) a plain vector, kept as the reference for the
+/// behaviour checks and benchmarks of FlagList.
+///
+namespace VectorFlags
+{
+
+typedef std::vector<std::string> List;
+typedef List::iterator::difference_type Offset;
+
+inline void
+addIfMissing( List &l, const std::string &v )
+{
+	if ( v.empty() )
+		return;
+
+	for ( const std::string &i: l )
+	{
+		if ( i == v )
+			return;
+	}
+	l.push_back( v );
+}
+
+inline void
+moveToEnd( List &l, const std::string &v )
+{
+	if ( v.empty() )
+		return;
+
+	auto i = l.begin();
+	while ( i != l.end() )
+	{
+		if ( (*i) == v )
+		{
+			l.erase( i );
+			i = l.begin();
+			continue;
+		}
+		++i;
+	}
+	l.push_back( v );
+}
+
+inline void
+removeDuplicatesKeepLast( List &l )
+{
+	for ( size_t i = 0; i != l.size(); ++i )
+	{
+		bool kill = false;
+		for ( size_t j = i + 1; j < l.size(); ++j )
+		{
+			if ( l[j] == l[i] )
+			{
+				kill = true;
+				break;
+			}
+		}
+
+		if ( kill )
+		{
+			l.erase( l.begin() + static_cast<Offset>( i ) );
+			--i;
+		}
+	}
+}
+
+inline void
+removeDuplicates( List &l, const std::map<std::string, bool> &prefixDisposition )
+{
+	for ( size_t i = 0; i < l.size(); ++i )
+	{
+		const std::string cur = l[i];
+		bool inPref = false;
+		bool first = true;
+		for ( auto &x: prefixDisposition )
+		{
+			if ( cur.compare( 0, x.first.size(), x.first ) == 0 )
+			{
+				inPref = true;
+				first = x.second;
+				break;
+			}
+		}
+		if ( ! inPref )
+			continue;
+
+		if ( first )
+		{
+			for ( size_t j = i + 1; j < l.size(); ++j )
+			{
+				if ( l[j] == cur )
+				{
+					l.erase( l.begin() + static_cast<Offset>( j ) );
+					--j;
+				}
+			}
+		}
+		else
+		{
+			bool kill = false;
+			for ( size_t j = i + 1; j < l.size(); ++j )
+			{
+				if ( l[j] == cur )
+				{
+					kill = true;
+					break;
+				}
+			}
+
+			if ( kill )
+			{
+				l.erase( l.begin() + static_cast<Offset>( i ) );
+				--i;
+			}
+		}
+	}
+}
+
+} // namespace VectorFlags
+